@@ -0,0 +1,64 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+static char *classname[NSCHEDCLASS] = { "mlfq", "stride", "cfs", "edf" };
+
+// 프로세스의 스케줄링 클래스를 출력하거나 바꾸는 프로그램
+//   chsched <pid>                     클래스 출력 (pid 0 은 자기 자신)
+//   chsched <pid> mlfq                MLFQ 로 바꾼다
+//   chsched <pid> stride <tickets>    tickets 장을 가진 stride 프로세스로 바꾼다
+//   chsched <pid> cfs <nice>          nice 인 CFS 프로세스로 바꾼다 (-20 ~ 19)
+//   chsched <pid> edf <runtime> <period> [deadline]
+//                                     period tick 마다 runtime tick 을 예약한 EDF 프로세스로 바꾼다
+int main(int argc, char **argv) {
+  struct schedattr attr;
+  int pid;
+
+  if(argc < 2 || argc > 6) { // 입력 방식이 잘못됐을 경우 에러처리
+    printf(2, "usage : chsched <pid> [mlfq | stride <tickets> | cfs <nice> | edf <runtime> <period> [deadline]]\n");
+    exit();
+  }
+  pid = atoi(argv[1]);
+
+  if(argc > 2) {
+    memset(&attr, 0, sizeof(attr));
+    if(strcmp(argv[2], "mlfq") == 0 && argc == 3)
+      attr.class = SCHED_MLFQ;
+    else if(strcmp(argv[2], "stride") == 0 && argc == 4) {
+      attr.class = SCHED_STRIDE;
+      attr.tickets = atoi(argv[3]);
+    } else if(strcmp(argv[2], "cfs") == 0 && argc == 4) {
+      attr.class = SCHED_CFS;
+      attr.nice = argv[3][0] == '-' ? -atoi(argv[3] + 1) : atoi(argv[3]); // atoi 는 부호를 읽지 않는다
+    } else if(strcmp(argv[2], "edf") == 0 && argc >= 5) {
+      attr.class = SCHED_EDF;
+      attr.runtime = atoi(argv[3]);
+      attr.period = atoi(argv[4]);
+      attr.deadline = argc == 6 ? atoi(argv[5]) : 0;
+    } else {
+      printf(2, "usage : chsched <pid> [mlfq | stride <tickets> | cfs <nice> | edf <runtime> <period> [deadline]]\n");
+      exit();
+    }
+    if(sched_setattr(pid, &attr) < 0) {
+      printf(2, "sched_setattr error\n");
+      exit();
+    }
+  }
+
+  if(sched_getattr(pid, &attr) < 0) {
+    printf(2, "sched_getattr error\n");
+    exit();
+  }
+  printf(1, "pid %d: %s", pid, attr.class >= 0 && attr.class < NSCHEDCLASS ? classname[attr.class] : "???");
+  if(attr.class == SCHED_STRIDE)
+    printf(1, ", tickets %d", attr.tickets);
+  if(attr.class == SCHED_CFS)
+    printf(1, ", nice %d", attr.nice);
+  if(attr.class == SCHED_EDF)
+    printf(1, ", runtime %d, deadline %d, period %d", attr.runtime, attr.deadline, attr.period);
+  printf(1, "\n");
+
+  exit();
+}
@@ -0,0 +1,76 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "mcslock.h"
+
+// getlockstat 으로 커널 MCS lock 의 경쟁 통계를 받아, 기다린 시간이 긴 순서로 출력하는 프로그램
+//   lockstat      같은 이름의 lock 을 묶어서 출력 (proc, sleepq, runq 는 여러 개다)
+//   lockstat -a   lock 마다 따로 출력
+
+static struct lockstat ls[NMCSLOCK];
+static int cnt[NMCSLOCK]; // 묶은 lock 의 수
+
+// part 가 whole 의 몇 % 인지. part*100 이 넘치지 않게 큰 수는 whole 을 먼저 나눈다.
+static uint
+pct(uint part, uint whole)
+{
+  if(whole == 0)
+    return 0;
+  if(part < 0x1000000)
+    return part * 100 / whole;
+  return part / (whole / 100);
+}
+
+int main(int argc, char **argv) {
+  struct lockstat t;
+  int i, j, n, m, all, c;
+
+  all = argc > 1 && strcmp(argv[1], "-a") == 0;
+  if(argc > 2 || (argc == 2 && !all)) { // 입력 방식이 잘못됐을 경우 에러처리
+    printf(2, "usage : lockstat [-a]\n");
+    exit();
+  }
+
+  if((n = getlockstat(ls, NMCSLOCK)) < 0) {
+    printf(2, "getlockstat error\n");
+    exit();
+  }
+
+  // 같은 이름끼리 앞쪽 항목에 더한다
+  for(m = 0, i = 0; i < n; i++) {
+    for(j = 0; !all && j < m && strcmp(ls[j].name, ls[i].name) != 0; j++)
+      ;
+    if(all || j == m) {
+      ls[m] = ls[i];
+      cnt[m++] = 1;
+      continue;
+    }
+    ls[j].nacquire += ls[i].nacquire;
+    ls[j].ncontend += ls[i].ncontend;
+    ls[j].spincyc += ls[i].spincyc;
+    cnt[j]++;
+  }
+
+  // 기다린 시간이 긴 순서로 정렬
+  for(i = 1; i < m; i++) {
+    t = ls[i];
+    c = cnt[i];
+    for(j = i; j > 0 && ls[j-1].spincyc < t.spincyc; j--) {
+      ls[j] = ls[j-1];
+      cnt[j] = cnt[j-1];
+    }
+    ls[j] = t;
+    cnt[j] = c;
+  }
+
+  // CONT% 는 다른 CPU 가 가지고 있어 기다려야 했던 비율, SPIN 은 기다리며 돈 시간 (2^10 cycle 단위)
+  printf(1, "NAME\tN\tACQ\tCONT\tCONT%%\tSPIN\n");
+  for(i = 0; i < m; i++) {
+    printf(1, "%s\t%d\t%d\t%d\t%d\t%d\n",
+           ls[i].name, cnt[i], ls[i].nacquire, ls[i].ncontend,
+           pct(ls[i].ncontend, ls[i].nacquire),
+           (uint)(ls[i].spincyc >> 10));
+  }
+
+  exit();
+}
@@ -0,0 +1,154 @@
+// MCS 큐 lock.
+// xchg spinlock 은 기다리는 CPU 가 모두 같은 lock 변수에 xchg 를 반복하므로, lock 을
+// 다투는 CPU 가 많아지면 cache line 이 CPU 사이를 계속 오가고 누가 얻을지도 정해지지 않는다.
+// MCS lock 은 기다리는 CPU 가 자기 노드를 큐의 꼬리에 붙이고 자기 노드의 locked 만 보며
+// 돌다가, 앞 CPU 가 놓을 때 넘겨받는다.
+//
+// 노드는 CPU 마다 MCS_NNODE 개를 두고 lock 을 잡을 때 빌린다. spinlock 처럼 잡는 동안
+// 인터럽트를 끄므로 (pushcli) 빌린 노드는 그 CPU 만 쓰고, 한 CPU 가 한꺼번에 잡을 수 있는
+// MCS lock 은 MCS_NNODE 개까지다. 잡은 CPU 와 놓는 CPU 는 같아야 한다
+// (p->lock 처럼 swtch 를 사이에 두고 놓는 lock 도 같은 CPU 안에서 넘어간다).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "mcslock.h"
+
+#define MCS_NNODE 8
+
+static struct {
+  uint used;                      // bit i: node[i] 를 빌려 쓰는 중
+  struct mcsnode node[MCS_NNODE];
+} mcspool[NCPU];
+
+// 통계를 읽을 수 있도록 초기화한 lock 을 모두 기억한다
+static struct mcslock *mcslocks[NMCSLOCK];
+static int nmcslock;
+
+void
+mcsinit(struct mcslock *lk, char *name)
+{
+  int i;
+
+  lk->tail = 0;
+  lk->node = 0;
+  lk->name = name;
+  lk->cpu = 0;
+  lk->nacquire = lk->ncontend = 0;
+  lk->spincyc = 0;
+  if((i = __sync_fetch_and_add(&nmcslock, 1)) < NMCSLOCK)
+    mcslocks[i] = lk;
+}
+
+// Acquire the lock.
+// Loops (spins) until the lock is acquired.
+// 꼬리에 노드를 붙였을 때 앞 노드가 있으면 넘겨받을 때까지 기다린다.
+void
+mcsacquire(struct mcslock *lk)
+{
+  struct mcsnode *n, *prev;
+  uint64 start;
+  uint *used;
+  int i;
+
+  pushcli(); // disable interrupts to avoid deadlock.
+  if(mcsholding(lk))
+    panic("mcsacquire");
+
+  used = &mcspool[cpuid()].used;
+  for(i = 0; i < MCS_NNODE && (*used >> i) & 1; i++)
+    ;
+  if(i == MCS_NNODE)
+    panic("mcsacquire nodes");
+  *used |= 1 << i;
+  n = &mcspool[cpuid()].node[i];
+  n->next = 0;
+  n->locked = 1;
+
+  prev = (struct mcsnode*)xchg((volatile uint*)&lk->tail, (uint)n);
+  if(prev){
+    start = rdtsc();
+    prev->next = n;
+    while(n->locked)
+      ;
+    lk->ncontend++;
+    lk->spincyc += rdtsc() - start;
+  }
+
+  // Tell the C compiler and the processor to not move loads or stores
+  // past this point, to ensure that the critical section's memory
+  // references happen after the lock is acquired.
+  __sync_synchronize();
+
+  lk->nacquire++;
+  lk->node = n;
+  lk->cpu = mycpu();
+}
+
+// Release the lock.
+// 뒤에 기다리는 노드가 있으면 넘겨주고, 없으면 꼬리를 비운다. 꼬리를 비우지 못했으면
+// 누군가 막 꼬리에 붙은 것이므로 그 노드가 next 에 보일 때까지 기다렸다가 넘겨준다.
+void
+mcsrelease(struct mcslock *lk)
+{
+  struct mcsnode *n = lk->node;
+
+  if(!mcsholding(lk))
+    panic("mcsrelease");
+
+  lk->node = 0;
+  lk->cpu = 0;
+
+  // Make sure all the stores in the critical section are visible
+  // to other cores before the lock is released.
+  __sync_synchronize();
+
+  if(n->next == 0 && !__sync_bool_compare_and_swap(&lk->tail, n, 0)){
+    while(n->next == 0)
+      ;
+  }
+  if(n->next)
+    n->next->locked = 0;
+
+  mcspool[cpuid()].used &= ~(1 << (n - mcspool[cpuid()].node));
+  popcli();
+}
+
+// Check whether this cpu is holding the lock.
+int
+mcsholding(struct mcslock *lk)
+{
+  int r;
+
+  pushcli();
+  r = lk->node != 0 && lk->cpu == mycpu();
+  popcli();
+  return r;
+}
+
+// 초기화한 lock 의 통계를 최대 n 개까지 ls 에 채우고 채운 개수를 돌려준다.
+// 통계는 lock 을 가진 CPU 가 더하므로 lock 없이 읽으면 조금 어긋날 수 있다.
+int
+getlockstat(struct lockstat *ls, int n)
+{
+  struct mcslock *lk;
+  struct lockstat st;
+  int i;
+
+  memset(&st, 0, sizeof(st));
+
+  for(i = 0; i < n && i < nmcslock && i < NMCSLOCK; i++){
+    lk = mcslocks[i];
+    safestrcpy(st.name, lk->name, sizeof(st.name));
+    st.nacquire = lk->nacquire;
+    st.ncontend = lk->ncontend;
+    st.spincyc = lk->spincyc;
+    if(copyuser(&ls[i], &st, sizeof(st)) < 0)
+      return -1;
+  }
+  return i;
+}
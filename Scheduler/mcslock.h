@@ -0,0 +1,32 @@
+// MCS 큐 lock (mcslock.c).
+// 기다리는 CPU 는 lock 의 꼬리에 자기 노드를 붙이고 자기 노드만 보며 돌기 때문에
+// 온 순서대로 lock 을 얻고, 기다리는 CPU 끼리 같은 cache line 을 두고 다투지 않는다.
+
+struct mcsnode {
+  struct mcsnode *volatile next;  // 내 다음에 기다리는 CPU 의 노드
+  volatile uint locked;           // 앞 CPU 가 lock 을 넘겨주면 0
+};
+
+struct mcslock {
+  struct mcsnode *volatile tail;  // 마지막으로 기다리기 시작한 노드 (0 이면 비어 있음)
+  struct mcsnode *node;           // lock 을 가진 CPU 의 노드
+
+  // For debugging:
+  char *name;                     // Name of lock.
+  struct cpu *cpu;                // The cpu holding the lock.
+
+  // 통계. lock 을 가진 CPU 만 더한다.
+  uint nacquire;                  // 얻은 횟수
+  uint ncontend;                  // 그 중 다른 CPU 가 가지고 있어 기다린 횟수
+  uint64 spincyc;                 // 기다리며 돈 시간 (TSC cycle)
+};
+
+// getlockstat 으로 돌려주는 lock 하나의 통계
+struct lockstat {
+  char name[16];
+  uint nacquire;
+  uint ncontend;
+  uint64 spincyc;
+};
+
+#define NMCSLOCK 192  // 통계를 모으는 lock 의 최대 수
@@ -0,0 +1,143 @@
+// MLFQ 정책.
+// 어느 큐에서 꺼낼지, time quantum 을 다 썼는지, 다음에 어느 큐로 갈지,
+// Aging 으로 올릴지, 할당량을 다 써서 종료할지, 깨어날 때 얼마나 올릴지를 정한다.
+// 큐를 조작하거나 lock 을 잡는 일은 호출하는 쪽(proc.c, mlfqsim.c)이 한다.
+
+#include "types.h"
+#include "sched.h"
+#include "mlfq.h"
+
+// 설정이 올바르면 0, 아니면 -1.
+int
+mlfq_checkconfig(const struct schedconfig *sc)
+{
+  int level;
+
+  if(sc->nlevel < 1 || sc->nlevel > MAXQLEVEL || sc->aging <= 0)
+    return -1;
+  for(level = 0; level < sc->nlevel; level++)
+    if(sc->quantum[level] <= 0)
+      return -1;
+  return 0;
+}
+
+// 새 프로세스가 처음 들어갈 큐 단계.
+// init 과 sh 는 가장 낮은 우선순위 큐에서, 나머지는 가장 높은 큐에서 시작한다.
+int
+mlfq_initlevel(const struct schedconfig *sc, int pid)
+{
+  if(MLFQ_PRIVILEGED(pid))
+    return sc->nlevel - 1;
+  return 0;
+}
+
+// 단계 수가 줄어 범위를 벗어난 단계는 가장 낮은 단계로 옮긴다.
+int
+mlfq_clamp(const struct schedconfig *sc, int level)
+{
+  if(level >= sc->nlevel)
+    return sc->nlevel - 1;
+  return level;
+}
+
+// 비어 있지 않은 단계의 bitmap 에서 다음에 실행할 단계를 고른다.
+// 가장 낮은 비트가 가장 높은 우선순위다. bitmap 이 0 이면 -1.
+int
+mlfq_pick(uint bitmap)
+{
+  if(bitmap == 0)
+    return -1;
+  return __builtin_ctz(bitmap);
+}
+
+// 다른 CPU 가 훔쳐갈 단계를 고른다: 가장 낮은 우선순위 단계. bitmap 이 0 이면 -1.
+int
+mlfq_victim(uint bitmap)
+{
+  if(bitmap == 0)
+    return -1;
+  return 31 - __builtin_clz(bitmap);
+}
+
+// CPU 사용 할당량(end_time)을 다 썼으면 1. end_time 이 0 이면 할당량이 없다.
+int
+mlfq_done(int burst, int end_time)
+{
+  return end_time != 0 && end_time - burst <= 0;
+}
+
+// level 단계에서 이번 time quantum 에 slice 만큼 쓰고 CPU 를 내려놓은
+// 프로세스를 어떻게 할지 정한다. burst 는 지금까지 쓴 전체 CPU 시간이다.
+int
+mlfq_decide(const struct schedconfig *sc, int pid, int level, int slice, int burst, int end_time)
+{
+  int done = mlfq_done(burst, end_time);
+
+  if(slice < sc->quantum[level] && !done)
+    return MLFQ_RESUME;
+  if(done && !MLFQ_PRIVILEGED(pid))
+    return MLFQ_EXIT;
+  if(level < sc->nlevel-1)
+    return MLFQ_DEMOTE;
+  return MLFQ_EXPIRE;
+}
+
+// 결정에 따라 프로세스가 들어갈 다음 단계.
+int
+mlfq_next(const struct schedconfig *sc, int level, int decision)
+{
+  if(decision == MLFQ_DEMOTE && level < sc->nlevel-1)
+    return level + 1;
+  return level;
+}
+
+// qtick 부터 큐에서 기다린 프로세스를 now 에 한 단계 올려야 하면 1.
+// aging 은 mlfq_checkconfig 가 양수로 검사하므로 tick 처럼 uint 로 비교한다.
+int
+mlfq_aged(const struct schedconfig *sc, int pid, uint now, uint qtick)
+{
+  return !MLFQ_PRIVILEGED(pid) && now - qtick >= (uint)sc->aging;
+}
+
+// 최근 기록만 남도록 run + slp 가 limit 을 넘으면 둘 다 반으로 줄인다.
+// 둘의 비율은 그대로 두고, 오래된 시간일수록 여러 번 줄어 비중이 작아진다.
+void
+mlfq_decay(uint64 *run, uint64 *slp, uint64 limit)
+{
+  while(*run + *slp > limit){
+    *run >>= 1;
+    *slp >>= 1;
+  }
+}
+
+// 최근에 실행한 시간 run 과 스스로 잠든 시간 slp (단위는 같으면 된다)로 구한 점수.
+// 잠든 시간이 실행한 시간보다 길수록 0 에, 짧을수록 100 에 가깝다.
+// 기록이 없으면 중간값 50 이다.
+int
+mlfq_interact(uint64 run, uint64 slp)
+{
+  // 32비트 나눗셈으로 계산하도록 줄인다
+  while(run >= (1 << 24) || slp >= (1 << 24)){
+    run >>= 1;
+    slp >>= 1;
+  }
+  if(slp > run)
+    return 50 * (uint)run / (uint)slp;
+  if(run > slp)
+    return 100 - 50 * (uint)slp / (uint)run;
+  return 50;
+}
+
+// level 단계의 프로세스가 깨어났을 때 들어갈 단계.
+// 점수가 MLFQ_INTERACTIVE 보다 작으면 점수에 비례하는 위 단계로 올리고 (0 이면 가장 높은 단계),
+// 그렇지 않으면 (CPU 를 주로 쓰는 프로세스) 그대로 둔다.
+int
+mlfq_wakelevel(const struct schedconfig *sc, int pid, int level, int score)
+{
+  int target;
+
+  if(MLFQ_PRIVILEGED(pid) || score >= MLFQ_INTERACTIVE)
+    return level;
+  target = score * sc->nlevel / MLFQ_INTERACTIVE;
+  return target < level ? target : level;
+}
@@ -0,0 +1,29 @@
+// MLFQ 정책 모듈 (mlfq.c).
+// 커널 자료구조에 의존하지 않는 순수한 C 함수로만 이루어져 있어서
+// 커널과 호스트에서 돌리는 시뮬레이터(mlfqsim.c)가 같은 코드를 링크한다.
+// types.h 와 sched.h 를 먼저 include 해야 한다.
+
+#define MLFQ_PRIVILEGED(pid) ((pid) <= 2)  // init 과 sh: 가장 낮은 큐, Aging/종료 대상 아님
+
+// 프로세스가 CPU 를 내려놓을 때 mlfq_decide 가 내리는 결정
+#define MLFQ_RESUME 0  // time quantum 이 남았다: 같은 큐의 맨 앞에서 이어서 실행
+#define MLFQ_EXPIRE 1  // time quantum 을 다 썼지만 이미 가장 낮은 큐: 같은 큐의 맨 뒤
+#define MLFQ_DEMOTE 2  // time quantum 을 다 썼다: 다음 단계 큐의 맨 뒤
+#define MLFQ_EXIT   3  // CPU 사용 할당량(end_time)을 다 썼다: 종료
+
+// 잠든 시간과 실행한 시간으로 구하는 상호작용 점수 (mlfq_interact, 0 ~ 100)
+#define MLFQ_INTERACTIVE 30   // 점수가 이보다 작으면 깨어날 때 위 단계로 올린다
+#define MLFQ_HISTORY     100  // 실행/잠든 시간의 합을 이 tick 안쪽으로 유지한다 (오래된 기록은 반씩 줄어든다)
+
+int mlfq_checkconfig(const struct schedconfig *sc);
+int mlfq_initlevel(const struct schedconfig *sc, int pid);
+int mlfq_clamp(const struct schedconfig *sc, int level);
+int mlfq_pick(uint bitmap);
+int mlfq_victim(uint bitmap);
+int mlfq_done(int burst, int end_time);
+int mlfq_decide(const struct schedconfig *sc, int pid, int level, int slice, int burst, int end_time);
+int mlfq_next(const struct schedconfig *sc, int level, int decision);
+int mlfq_aged(const struct schedconfig *sc, int pid, uint now, uint qtick);
+void mlfq_decay(uint64 *run, uint64 *slp, uint64 limit);
+int mlfq_interact(uint64 run, uint64 slp);
+int mlfq_wakelevel(const struct schedconfig *sc, int pid, int level, int score);
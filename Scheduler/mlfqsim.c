@@ -0,0 +1,634 @@
+// mlfqsim: 커널과 같은 MLFQ 정책(mlfq.c)을 호스트에서 돌려보는 이산 사건 시뮬레이터.
+// QEMU 로 부팅하지 않고 정책을 바꿔가며 많은 프로세스의 작업 부하를 빠르게 돌려본다.
+//
+//   ./mlfqsim [-c ncpu] [-n nproc] [-w cpu|io|mix] [-e end_time] [-i interarrival]
+//             [-l nlevel] [-q q0,q1,...] [-a aging] [-s seed] [-t ms_per_tick] [-f file]
+//
+// -f 로 주는 작업 부하 파일은 프로세스마다 한 줄에 "도착tick end_time run io" 를 적는다.
+// run tick 동안 CPU 를 쓰고 io tick 동안 잠드는 것을 반복하며, io 가 0 이면 CPU-bound 이다.
+// '#' 로 시작하는 줄은 무시한다.
+//
+// 커널처럼 매 tick 마다 yield 하지 않고, 프로세스가 CPU 를 내려놓는 시점
+// (time quantum 끝, 할당량 끝, 잠듦)과 더 높은 우선순위 프로세스가 큐에 들어와
+// 선점되는 시점만 사건으로 처리한다. 실행 큐는 커널처럼 CPU 마다 두지 않고
+// 모든 CPU 가 하나를 같이 쓴다.
+//
+// 결과는 한 줄에 "이름 key=value ..." 형식으로 출력한다. 시간은 ms 단위다.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "types.h"
+#include "sched.h"
+#include "mlfq.h"
+
+#define NCLASS 3
+#define CPU_BOUND 0
+#define IO_BOUND  1
+#define MIXED     2
+
+static char *classname[NCLASS] = { "cpu", "io", "mix" };
+
+enum { NEW, RUNNABLE, RUNNING, SLEEPING, DONE };
+
+struct sproc {
+  int pid;
+  int class;
+  int state;
+  int level;
+  int burst;        // 지금까지 쓴 CPU 시간 (cpu_burst)
+  int ticks;        // 현재 time quantum 이 시작될 때의 burst
+  int end_time;     // CPU 사용 할당량
+  int run, io;      // run 만큼 CPU 를 쓰고 io 만큼 잠든다 (io 가 0 이면 CPU-bound)
+  int left;         // 다음에 잠들기까지 남은 CPU 시간
+  uint qtick;       // 이번에 큐에서 기다리기 시작한 시각
+  int waited;       // 이 단계에서 전에 큐에서 기다린 시간 (커널의 cpu_wait)
+  uint arrival, first, finish, wakeat;
+  int started;
+  double wakewait;  // 깨어난 뒤 CPU 에 올라가기까지 기다린 시간의 합
+  int nwake;
+  uint64 ivrun, ivslp; // 상호작용 점수용 최근 실행/잠든 시간 (커널의 p->ivrun, p->ivslp)
+  struct sproc *next, *prev;
+};
+
+struct scpu {
+  struct sproc *proc;
+  uint start;       // proc 이 CPU 에 올라간 시각
+  int gen;          // 선점되면 늘려서 이미 넣어둔 STOP 사건을 무효로 만든다
+};
+
+// 사건 종류
+#define EV_ARRIVE 0  // 프로세스 도착
+#define EV_WAKE   1  // 잠든 프로세스가 깨어남
+#define EV_STOP   2  // CPU 의 프로세스가 CPU 를 내려놓음
+#define EV_AGE    3  // 큐에서 기다리는 프로세스가 Aging 될 수 있는 시각
+
+struct event {
+  uint time;
+  uint seq;         // 같은 시각의 사건은 넣은 순서대로
+  int type;
+  int arg;          // 프로세스 번호 또는 CPU 번호
+  int gen;
+};
+
+static struct schedconfig sc = {
+  .nlevel = 4,
+  .quantum = {10, 20, 40, 80},
+  .aging = 250,
+};
+
+static struct sproc *procs;
+static int nproc;
+static struct scpu *cpus;
+static int ncpu = 1;
+
+static struct sproc *head[MAXQLEVEL], *tail[MAXQLEVEL];
+static uint bitmap;
+static int nrunnable;
+
+static struct event *heap;
+static int nheap, maxheap;
+static uint seq;
+
+static uint now;
+static long ndecide;
+
+static void
+panic(char *s)
+{
+  fprintf(stderr, "mlfqsim: %s\n", s);
+  exit(1);
+}
+
+static void*
+xmalloc(size_t n)
+{
+  void *p;
+
+  if((p = calloc(1, n)) == 0)
+    panic("out of memory");
+  return p;
+}
+
+//PAGEBREAK!
+// 사건 힙 (time, seq 가 가장 작은 사건이 맨 위)
+
+static int
+evless(struct event *a, struct event *b)
+{
+  if(a->time != b->time)
+    return a->time < b->time;
+  return a->seq < b->seq;
+}
+
+static void
+evpush(uint time, int type, int arg, int gen)
+{
+  struct event e, t;
+  int i;
+
+  if(nheap == maxheap){
+    maxheap = maxheap ? maxheap*2 : 1024;
+    if((heap = realloc(heap, maxheap * sizeof(*heap))) == 0)
+      panic("out of memory");
+  }
+  e.time = time;
+  e.seq = seq++;
+  e.type = type;
+  e.arg = arg;
+  e.gen = gen;
+  i = nheap++;
+  heap[i] = e;
+  while(i > 0 && evless(&heap[i], &heap[(i-1)/2])){
+    t = heap[i];
+    heap[i] = heap[(i-1)/2];
+    heap[(i-1)/2] = t;
+    i = (i-1)/2;
+  }
+}
+
+static struct event
+evpop(void)
+{
+  struct event e, t;
+  int i, c;
+
+  e = heap[0];
+  heap[0] = heap[--nheap];
+  for(i = 0; (c = 2*i+1) < nheap; i = c){
+    if(c+1 < nheap && evless(&heap[c+1], &heap[c]))
+      c++;
+    if(!evless(&heap[c], &heap[i]))
+      break;
+    t = heap[i];
+    heap[i] = heap[c];
+    heap[c] = t;
+  }
+  return e;
+}
+
+//PAGEBREAK!
+// 실행 큐 (커널의 rqinsert/rqremove 와 같은 규칙)
+
+static void
+enqueue(struct sproc *p, int front)
+{
+  int level = p->level;
+
+  p->qtick = now;
+  if(front){
+    p->prev = 0;
+    p->next = head[level];
+    if(p->next)
+      p->next->prev = p;
+    else
+      tail[level] = p;
+    head[level] = p;
+  } else {
+    p->next = 0;
+    p->prev = tail[level];
+    if(p->prev)
+      p->prev->next = p;
+    else
+      head[level] = p;
+    tail[level] = p;
+  }
+  bitmap |= 1 << level;
+  nrunnable++;
+  p->state = RUNNABLE;
+  if(level > 0 && !MLFQ_PRIVILEGED(p->pid))
+    evpush(p->qtick + sc.aging - p->waited, EV_AGE, p - procs, 0);
+}
+
+static void
+dequeue(struct sproc *p)
+{
+  int level = p->level;
+
+  if(p->prev)
+    p->prev->next = p->next;
+  else
+    head[level] = p->next;
+  if(p->next)
+    p->next->prev = p->prev;
+  else
+    tail[level] = p->prev;
+  p->next = p->prev = 0;
+  p->waited += now - p->qtick;
+  if(head[level] == 0)
+    bitmap &= ~(1 << level);
+  nrunnable--;
+}
+
+// 커널의 mlfqtick 과 같다: 각 단계의 앞에서부터 Aging 할 프로세스를 올리고,
+// 아직 때가 안 된 첫 프로세스에서 멈춘다.
+static void
+age(void)
+{
+  struct sproc *p, *next;
+  int level;
+
+  for(level = 1; level < sc.nlevel; level++){
+    for(p = head[level]; p; p = next){
+      next = p->next;
+      if(MLFQ_PRIVILEGED(p->pid))
+        continue;
+      if(!mlfq_aged(&sc, p->pid, now, p->qtick - p->waited))
+        break;
+      dequeue(p);
+      p->level = level - 1;
+      p->waited = 0;
+      enqueue(p, 0);
+    }
+  }
+}
+
+//PAGEBREAK!
+// CPU 에 올리고 내리기
+
+static void
+dispatch(int c)
+{
+  struct sproc *p;
+  int level, run;
+
+  level = mlfq_pick(bitmap);
+  ndecide++;
+  p = head[level];
+  dequeue(p);
+  p->state = RUNNING;
+  if(!p->started){
+    p->started = 1;
+    p->first = now;
+  }
+  if(p->wakeat != (uint)-1){
+    p->wakewait += now - p->wakeat;
+    p->nwake++;
+    p->wakeat = (uint)-1;
+  }
+  cpus[c].proc = p;
+  cpus[c].start = now;
+
+  // time quantum, 할당량, 잠들 때까지 중 가장 먼저 끝나는 시점에 내려놓는다
+  run = sc.quantum[level] - (p->burst - p->ticks);
+  if(p->end_time > 0 && p->end_time - p->burst < run)
+    run = p->end_time - p->burst;
+  if(p->io > 0 && p->left < run)
+    run = p->left;
+  if(run < 1)
+    run = 1;
+  evpush(now + run, EV_STOP, c, cpus[c].gen);
+}
+
+// CPU c 의 프로세스가 CPU 를 내려놓는다. 커널의 mlfqupdate 와 같은 결정을 따른다.
+static void
+stop(int c)
+{
+  struct sproc *p = cpus[c].proc;
+  int ran, sleeping, decision;
+
+  cpus[c].proc = 0;
+  cpus[c].gen++;
+  ran = now - cpus[c].start;
+  p->burst += ran;
+  p->left -= ran;
+  p->ivrun += ran;
+  mlfq_decay(&p->ivrun, &p->ivslp, MLFQ_HISTORY);
+  sleeping = p->io > 0 && p->left <= 0;
+
+  p->level = mlfq_clamp(&sc, p->level);
+  decision = mlfq_decide(&sc, p->pid, p->level, p->burst - p->ticks, p->burst, p->end_time);
+  ndecide++;
+  if(decision != MLFQ_RESUME){
+    p->ticks = p->burst;
+    p->waited = 0;
+    if(decision == MLFQ_EXIT){
+      p->state = DONE;
+      p->finish = now;
+      return;
+    }
+    p->level = mlfq_next(&sc, p->level, decision);
+  }
+  if(sleeping){
+    p->state = SLEEPING;
+    p->left = p->run;
+    evpush(now + p->io, EV_WAKE, p - procs, 0);
+  } else
+    enqueue(p, decision == MLFQ_RESUME);
+}
+
+// io 만큼 잠들었던 프로세스가 깨어난다. 커널의 mlfqwake 처럼 자주 잠드는 프로세스는 위 단계로 올린다.
+static void
+wake(struct sproc *p)
+{
+  int level;
+
+  p->wakeat = now;
+  p->ivslp += p->io;
+  mlfq_decay(&p->ivrun, &p->ivslp, MLFQ_HISTORY);
+  level = mlfq_wakelevel(&sc, p->pid, p->level, mlfq_interact(p->ivrun, p->ivslp));
+  if(level < p->level){
+    p->level = level;
+    p->ticks = p->burst;
+    p->waited = 0;
+  }
+  enqueue(p, 0);
+}
+
+// 빈 CPU 에 프로세스를 올리고, 큐에 실행 중인 프로세스보다 높은 우선순위의
+// 프로세스가 있으면 가장 낮은 우선순위로 실행 중인 프로세스를 선점한다.
+// (커널에서는 매 tick 마다 yield 하므로 다음 tick 에 선점된다.)
+static void
+schedule(void)
+{
+  int c, worst;
+
+  age();
+  for(;;){
+    if(nrunnable == 0)
+      return;
+    for(c = 0; c < ncpu; c++)
+      if(cpus[c].proc == 0)
+        break;
+    if(c < ncpu){
+      dispatch(c);
+      continue;
+    }
+    worst = 0;
+    for(c = 1; c < ncpu; c++)
+      if(cpus[c].proc->level > cpus[worst].proc->level)
+        worst = c;
+    if(mlfq_pick(bitmap) >= cpus[worst].proc->level || now == cpus[worst].start)
+      return;
+    stop(worst);
+  }
+}
+
+//PAGEBREAK!
+// 작업 부하
+
+static void
+newproc(struct sproc *p, uint arrival, int end_time, int run, int io)
+{
+  p->pid = (p - procs) + 3;  // init 과 sh 다음부터
+  p->state = NEW;
+  p->level = mlfq_initlevel(&sc, p->pid);
+  p->end_time = end_time;
+  p->run = run;
+  p->io = io;
+  p->left = run;
+  p->arrival = arrival;
+  p->wakeat = (uint)-1;
+  if(io == 0)
+    p->class = CPU_BOUND;
+  else if(run <= 3)
+    p->class = IO_BOUND;
+  else
+    p->class = MIXED;
+}
+
+static int
+between(int lo, int hi)
+{
+  return lo + rand() % (hi - lo + 1);
+}
+
+// 평균 interarrival tick 간격으로 도착하는 nproc 개의 프로세스를 만든다.
+static void
+genworkload(char *kind, int end_time, int interarrival)
+{
+  struct sproc *p;
+  uint arrival = 0;
+  int class;
+
+  procs = xmalloc(nproc * sizeof(*procs));
+  for(p = procs; p < &procs[nproc]; p++){
+    if(strcmp(kind, "cpu") == 0)
+      class = CPU_BOUND;
+    else if(strcmp(kind, "io") == 0)
+      class = IO_BOUND;
+    else if(strcmp(kind, "mix") == 0)
+      class = rand() % NCLASS;
+    else
+      panic("workload must be cpu, io or mix");
+    switch(class){
+    case CPU_BOUND:
+      newproc(p, arrival, between(end_time/2, end_time*3/2), 0, 0);
+      break;
+    case IO_BOUND:
+      newproc(p, arrival, between(end_time/8, end_time/4), between(1, 3), between(5, 20));
+      break;
+    default:
+      newproc(p, arrival, between(end_time/2, end_time), between(5, 30), between(2, 10));
+      break;
+    }
+    if(interarrival > 0)
+      arrival += between(0, 2*interarrival);
+  }
+}
+
+static void
+readworkload(char *file)
+{
+  FILE *f;
+  char line[256];
+  uint arrival;
+  int end_time, run, io, max = 0;
+
+  if((f = fopen(file, "r")) == 0)
+    panic("cannot open workload file");
+  while(fgets(line, sizeof(line), f)){
+    if(line[0] == '#' || sscanf(line, "%u %d %d %d", &arrival, &end_time, &run, &io) != 4)
+      continue;
+    if(end_time <= 0 || run < 0 || io < 0 || (io > 0 && run == 0))
+      panic("bad workload line");
+    if(nproc == max){
+      max = max ? max*2 : 256;
+      if((procs = realloc(procs, max * sizeof(*procs))) == 0)
+        panic("out of memory");
+    }
+    memset(&procs[nproc], 0, sizeof(procs[nproc]));
+    nproc++;
+    newproc(&procs[nproc-1], arrival, end_time, run, io);
+  }
+  fclose(f);
+}
+
+//PAGEBREAK!
+// 결과
+
+static int
+dblcmp(const void *a, const void *b)
+{
+  double x = *(double*)a, y = *(double*)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static double
+percentile(double *v, int n, int pct)
+{
+  int i = (n * pct + 99) / 100 - 1;
+
+  return v[i < 0 ? 0 : i];
+}
+
+// class 가 -1 이면 모든 프로세스. 완료된 프로세스만 센다.
+static void
+report(char *name, int class, double tickms, int which)
+{
+  double *v, sum = 0;
+  struct sproc *p;
+  int n = 0;
+
+  v = xmalloc(nproc * sizeof(*v));
+  for(p = procs; p < &procs[nproc]; p++){
+    if(p->state != DONE || (class >= 0 && p->class != class))
+      continue;
+    switch(which){
+    case 0: v[n] = p->finish - p->arrival; break;
+    case 1: v[n] = p->first - p->arrival; break;
+    default:
+      if(p->nwake == 0)
+        continue;
+      v[n] = p->wakewait / p->nwake;
+      break;
+    }
+    v[n] *= tickms;
+    sum += v[n++];
+  }
+  if(n > 0){
+    qsort(v, n, sizeof(*v), dblcmp);
+    printf("%s class=%s n=%d mean=%.1f p50=%.1f p95=%.1f p99=%.1f max=%.1f\n",
+           name, class < 0 ? "all" : classname[class], n, sum / n,
+           percentile(v, n, 50), percentile(v, n, 95), percentile(v, n, 99), v[n-1]);
+  }
+  free(v);
+}
+
+// 살아 있는 동안 CPU 를 쓴 비율(burst / turnaround)에 대한 Jain 공정성 지수.
+static void
+fairness(int class)
+{
+  struct sproc *p;
+  double x, sum = 0, sumsq = 0;
+  int n = 0;
+
+  for(p = procs; p < &procs[nproc]; p++){
+    if(p->state != DONE || p->finish == p->arrival || (class >= 0 && p->class != class))
+      continue;
+    x = (double)p->burst / (p->finish - p->arrival);
+    sum += x;
+    sumsq += x * x;
+    n++;
+  }
+  if(n > 0)
+    printf("fairness class=%s n=%d jain=%.4f\n",
+           class < 0 ? "all" : classname[class], n, sum * sum / (n * sumsq));
+}
+
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: mlfqsim [-c ncpu] [-n nproc] [-w cpu|io|mix] [-e end_time] "
+          "[-i interarrival] [-l nlevel] [-q q0,q1,...] [-a aging] [-s seed] "
+          "[-t ms_per_tick] [-f file]\n");
+  exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *kind = "mix", *file = 0, *s;
+  int i, c, end_time = 500, interarrival = 500, ndone = 0, nq = 0;
+  double tickms = 10, wallms;
+  struct timeval t0, t1;
+  struct event e;
+
+  nproc = 1000;
+  for(i = 1; i < argc; i++){
+    if(argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0 || i+1 >= argc)
+      usage();
+    s = argv[++i];
+    switch(argv[i-1][1]){
+    case 'c': ncpu = atoi(s); break;
+    case 'n': nproc = atoi(s); break;
+    case 'w': kind = s; break;
+    case 'e': end_time = atoi(s); break;
+    case 'i': interarrival = atoi(s); break;
+    case 'l': sc.nlevel = atoi(s); break;
+    case 'a': sc.aging = atoi(s); break;
+    case 's': srand(atoi(s)); break;
+    case 't': tickms = atof(s); break;
+    case 'f': file = s; break;
+    case 'q':
+      for(nq = 0; nq < MAXQLEVEL && *s; nq++){
+        sc.quantum[nq] = strtol(s, &s, 10);
+        if(*s == ',')
+          s++;
+      }
+      break;
+    default:
+      usage();
+    }
+  }
+  // 단계 수만 늘리고 quantum 을 주지 않았으면 마지막 quantum 을 두 배씩 늘려 채운다
+  for(i = nq ? nq : 4; i < sc.nlevel && i < MAXQLEVEL; i++)
+    sc.quantum[i] = sc.quantum[i-1] * 2;
+  if(mlfq_checkconfig(&sc) < 0 || ncpu < 1 || end_time < 8)
+    panic("bad configuration");
+
+  if(file)
+    readworkload(file);
+  else if(nproc > 0)
+    genworkload(kind, end_time, interarrival);
+  if(nproc <= 0)
+    panic("no processes");
+  cpus = xmalloc(ncpu * sizeof(*cpus));
+
+  gettimeofday(&t0, 0);
+  for(i = 0; i < nproc; i++)
+    evpush(procs[i].arrival, EV_ARRIVE, i, 0);
+  while(nheap > 0){
+    // 같은 시각의 사건을 모두 처리한 뒤에 한 번 스케줄한다
+    now = heap[0].time;
+    while(nheap > 0 && heap[0].time == now){
+      e = evpop();
+      switch(e.type){
+      case EV_ARRIVE:
+        enqueue(&procs[e.arg], 0);
+        break;
+      case EV_WAKE:
+        wake(&procs[e.arg]);
+        break;
+      case EV_STOP:
+        if(cpus[e.arg].gen == e.gen && cpus[e.arg].proc)
+          stop(e.arg);
+        break;
+      }
+    }
+    schedule();
+  }
+  gettimeofday(&t1, 0);
+  wallms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_usec - t0.tv_usec) / 1000.0;
+
+  for(i = 0; i < nproc; i++)
+    if(procs[i].state == DONE)
+      ndone++;
+
+  printf("config nlevel=%d quantum=", sc.nlevel);
+  for(i = 0; i < sc.nlevel; i++)
+    printf(i ? ",%d" : "%d", sc.quantum[i]);
+  printf(" aging=%d ncpu=%d nproc=%d tickms=%g\n", sc.aging, ncpu, nproc, tickms);
+  for(c = -1; c < NCLASS; c++){
+    report("turnaround", c, tickms, 0);
+    report("response", c, tickms, 1);
+    report("wakeup", c, tickms, 2);
+    fairness(c);
+  }
+  printf("sim ticks=%u done=%d decisions=%ld wall_ms=%.3f decisions_per_sec=%.0f\n",
+         now, ndone, ndecide, wallms, wallms > 0 ? ndecide / wallms * 1000 : 0);
+  exit(0);
+}
@@ -0,0 +1,498 @@
+// mmap/munmap.
+// mapping 은 pgdir 마다 모아 두므로 같은 주소 공간을 쓰는 스레드는 mapping 도 함께 쓴다.
+// 페이지는 mmap 할 때 할당하지 않고 처음 건드릴 때 (mmapfault) 0 으로 채우거나 파일에서
+// 읽어 넣는다. 그 뒤로는 read/lseek 없이 메모리로 바로 읽고 쓴다. MAP_SHARED 파일 mapping 에서
+// 쓴 페이지는 munmap 할 때나, 주소 공간을 쓰는 마지막 프로세스가 exit 할 때 파일에 돌려 쓴다.
+//
+// MAP_SHARED 페이지는 mapping 마다 따로 두지 않고 (파일의 inode 또는 익명 mapping 번호, 페이지 번호)
+// 로 찾는 공유 페이지 표 (spage) 에 하나만 둔다. fork 한 자식이나 같은 파일을 비춘 다른
+// 프로세스도 폴트가 나면 같은 페이지를 넣으므로, fork 뒤에 처음 건드린 페이지도 함께 쓴다.
+// 표가 참조를 하나 갖고 페이지 테이블마다 하나씩 더 가지며, 표만 남으면 페이지를 해제한다.
+//
+// 페이지는 prot 대로 넣는다 (PROT_WRITE 가 없으면 읽기 전용). 사용자가 허락되지 않은 접근을
+// 하면 죽는다. 커널이 시스템 호출 안에서 그런 접근을 하면 폴트를 되돌릴 수 없으므로 그 주소에
+// 버릴 페이지를 넣어 접근을 마치게 하고, 프로세스는 사용자 모드로 돌아갈 때 죽인다.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "fs.h"
+#include "stat.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+#include "traps.h"
+#include "mmap.h"
+
+#define NVMA 64       // 시스템 전체의 mapping 수
+#define NSPAGE 1024   // MAP_SHARED mapping 들이 함께 쓰는 페이지 수
+#define NSHASH 64
+#define SHASH(obj, pg) (((obj) / 4 + (pg)) % NSHASH)
+
+struct vma {
+  pde_t *pgdir;     // mapping 을 가진 주소 공간 (0 이면 빈 항목)
+  uint addr;        // 시작 주소 (페이지 경계)
+  uint len;         // 길이 (페이지 단위)
+  int prot;         // PROT_*
+  int flags;        // MAP_*
+  struct file *f;   // MAP_ANON 이면 0
+  uint off;         // addr 에 대응하는 파일 위치
+  uint obj;         // MAP_SHARED 페이지를 찾는 열쇠. 파일이면 inode 주소, 익명이면 mmap 마다 새 번호
+};
+
+// 공유 페이지 표의 항목. 페이지 번호는 obj 안에서의 위치 (off / PGSIZE) 다.
+struct spage {
+  uint obj;             // 0 이면 빈 항목
+  uint pg;
+  char *mem;
+  struct spage *next;   // 같은 해시 버킷, 또는 빈 항목 목록의 다음
+};
+
+// 파일을 읽고 쓰는 동안에도 잡고 있으므로 sleeplock 이다.
+// 잠금 순서: mmtab.lock → log (begin_op) → inode lock
+static struct {
+  struct sleeplock lock;
+  struct vma vma[NVMA];
+  struct spage spage[NSPAGE];
+  struct spage *shash[NSHASH];
+  struct spage *sfree;
+  uint nextanon;        // 다음 익명 MAP_SHARED mapping 의 obj (inode 주소와 겹치지 않게 작은 수)
+} mmtab;
+
+void
+mmapinit(void)
+{
+  struct spage *s;
+
+  initsleeplock(&mmtab.lock, "mmap");
+  for(s = mmtab.spage; s < &mmtab.spage[NSPAGE]; s++){
+    s->next = mmtab.sfree;
+    mmtab.sfree = s;
+  }
+  mmtab.nextanon = 1;
+}
+
+// pgdir 에서 va 를 포함하는 mapping. mmtab.lock 을 잡고 부른다.
+static struct vma*
+findvma(pde_t *pgdir, uint va)
+{
+  struct vma *v;
+
+  for(v = mmtab.vma; v < &mmtab.vma[NVMA]; v++)
+    if(v->pgdir == pgdir && va >= v->addr && va < v->addr + v->len)
+      return v;
+  return 0;
+}
+
+static struct vma*
+allocvma(void)
+{
+  struct vma *v;
+
+  for(v = mmtab.vma; v < &mmtab.vma[NVMA]; v++)
+    if(v->pgdir == 0)
+      return v;
+  return 0;
+}
+
+static void
+freevma(struct vma *v)
+{
+  if(v->f)
+    fileclose(v->f);
+  v->f = 0;
+  v->pgdir = 0;
+}
+
+// pgdir 에서 len 바이트를 넣을 수 있는 가장 낮은 빈 주소. 없으면 0.
+static uint
+findhole(pde_t *pgdir, uint len)
+{
+  struct vma *v;
+  uint a;
+
+  for(a = MMAPBASE; ; a = v->addr + v->len){
+    if(a + len < a || a + len > KERNBASE)
+      return 0;
+    for(v = mmtab.vma; v < &mmtab.vma[NVMA]; v++)
+      if(v->pgdir == pgdir && a < v->addr + v->len && v->addr < a + len)
+        break;
+    if(v == &mmtab.vma[NVMA])
+      return a;
+  }
+}
+
+// v 의 va 페이지 내용을 mem 에 채운다. 익명이면 0, 파일이면 대응하는 위치를 읽는다.
+// 파일 끝 뒤는 0 으로 남는다.
+static void
+fillpage(struct vma *v, uint va, char *mem)
+{
+  memset(mem, 0, PGSIZE);
+  if(v->f){
+    ilock(v->f->ip);
+    readi(v->f->ip, mem, v->off + (va - v->addr), PGSIZE);
+    iunlock(v->f->ip);
+  }
+}
+
+// MAP_SHARED mapping v 의 va 페이지. 표에 없으면 새로 채워 넣는다 (표가 참조 하나를 갖는다).
+// 표가 가득 찼거나 메모리가 모자라면 0.
+static char*
+sharedget(struct vma *v, uint va)
+{
+  uint pg = (v->off + (va - v->addr)) / PGSIZE;
+  struct spage *s;
+
+  for(s = mmtab.shash[SHASH(v->obj, pg)]; s; s = s->next)
+    if(s->obj == v->obj && s->pg == pg)
+      return s->mem;
+  if((s = mmtab.sfree) == 0)
+    return 0;
+  if((s->mem = kalloc()) == 0)
+    return 0;
+  fillpage(v, va, s->mem);
+  mmtab.sfree = s->next;
+  s->obj = v->obj;
+  s->pg = pg;
+  s->next = mmtab.shash[SHASH(s->obj, pg)];
+  mmtab.shash[SHASH(s->obj, pg)] = s;
+  return s->mem;
+}
+
+// MAP_SHARED mapping v 의 [start, end) 를 페이지 테이블에서 뺀 뒤 부른다.
+// 이제 어느 페이지 테이블에도 없는 (표의 참조만 남은) 페이지를 해제한다.
+static void
+sharedrelease(struct vma *v, uint start, uint end)
+{
+  uint first = (v->off + (start - v->addr)) / PGSIZE;
+  uint last = (v->off + (end - v->addr)) / PGSIZE;
+  struct spage **ps, *s;
+  int i;
+
+  for(i = 0; i < NSHASH; i++){
+    for(ps = &mmtab.shash[i]; (s = *ps) != 0; ){
+      if(s->obj != v->obj || s->pg < first || s->pg >= last || krefcount(s->mem) > 1){
+        ps = &s->next;
+        continue;
+      }
+      *ps = s->next;
+      kfree(s->mem);
+      s->obj = 0;
+      s->mem = 0;
+      s->next = mmtab.sfree;
+      mmtab.sfree = s;
+    }
+  }
+}
+
+// 공유 파일 mapping 에서 va 페이지 (커널 주소 mem) 를 파일에 쓴다.
+// filewrite 처럼 log 가 넘치지 않게 나눠 쓰고, 파일 끝을 넘는 부분은 쓰지 않는다.
+static void
+writeback(struct vma *v, uint va, char *mem)
+{
+  struct inode *ip = v->f->ip;
+  uint off = v->off + (va - v->addr);
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * 512;
+  int i, n;
+
+  for(i = 0; i < PGSIZE; i += n){
+    n = PGSIZE - i;
+    if(n > max)
+      n = max;
+    begin_op();
+    ilock(ip);
+    if(off + i >= ip->size){
+      iunlock(ip);
+      end_op();
+      break;
+    }
+    if(n > ip->size - (off + i))
+      n = ip->size - (off + i);
+    writei(ip, mem + i, off + i, n);
+    iunlock(ip);
+    end_op();
+  }
+}
+
+// v 의 [start, end) 페이지를 뺀다. MAP_SHARED 파일 mapping 에서 쓴 페이지는 먼저 파일에 쓴다.
+// 다른 CPU 에서 도는 스레드가 같은 주소 공간을 쓰고 있을 수 있으므로 그 TLB 를 비운 뒤에
+// 페이지를 해제한다. 다른 mapping 과 함께 쓰는 페이지는 kfree 가 참조 수만 줄인다.
+static void
+unmaprange(struct vma *v, uint start, uint end)
+{
+  uint a;
+  char *mem;
+  int dirty;
+
+  if(v->f && (v->flags & MAP_SHARED) && (v->prot & PROT_WRITE)){
+    for(a = start; a < end; a += PGSIZE)
+      if((mem = uvmpage(v->pgdir, a, &dirty)) != 0 && dirty)
+        writeback(v, a, mem);
+  }
+  uvmzap(v->pgdir, start, end);
+  tlbshootdown(v->pgdir);
+  uvmreap(v->pgdir, start, end);
+  if(v->flags & MAP_SHARED)
+    sharedrelease(v, start, end);
+}
+
+// 없는 va 페이지를 v 의 prot 대로 넣는다. 실패하면 -1.
+static int
+fillfault(struct vma *v, uint va)
+{
+  int perm = PTE_U | ((v->prot & PROT_WRITE) ? PTE_W : 0);
+  char *mem;
+
+  if(v->flags & MAP_SHARED){
+    if((mem = sharedget(v, va)) == 0)
+      return -1;
+    kincref(mem);
+  } else {
+    if((mem = kalloc()) == 0)
+      return -1;
+    fillpage(v, va, mem);
+  }
+  if(uvmmap(v->pgdir, va, mem, perm) < 0){
+    kfree(mem);
+    if(v->flags & MAP_SHARED)
+      sharedrelease(v, va, va + PGSIZE);
+    return -1;
+  }
+  return 0;
+}
+
+// 커널이 시스템 호출 안에서 v 의 prot 가 허락하지 않는 접근을 하다 va 에서 폴트가 났다.
+// 되돌릴 수 없으므로 va 에 있던 페이지를 빼고 버릴 페이지를 넣어 접근을 마치게 하고,
+// 프로세스는 사용자 모드로 돌아갈 때 죽인다. 버릴 페이지는 PROT_WRITE 가 없는 mapping 에만
+// 들어가므로 파일에 돌려 쓰이지 않는다.
+static int
+discardfault(struct vma *v, uint va)
+{
+  char *mem;
+
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  if(uvmpage(v->pgdir, va, 0) != 0)
+    unmaprange(v, va, va + PGSIZE);
+  if(uvmmap(v->pgdir, va, mem, PTE_W|PTE_U) < 0){
+    kfree(mem);
+    return -1;
+  }
+  myproc()->killed = 1;
+  return 0;
+}
+
+// 빈 주소에 len 바이트의 mapping 을 만들고 그 주소를 돌려준다. 실패하면 -1.
+// MAP_ANON 이 아니면 파일 f 의 off 부터를 비춘다. 페이지는 처음 건드릴 때 채운다.
+uint
+mmap(uint len, int prot, int flags, struct file *f, uint off)
+{
+  struct proc *curproc = myproc();
+  struct vma *v;
+  uint addr;
+  int type;
+
+  len = PGROUNDUP(len);
+  if(len == 0 || off % PGSIZE != 0 || (prot & ~(PROT_READ|PROT_WRITE)) != 0)
+    return -1;
+  type = flags & (MAP_SHARED|MAP_PRIVATE);
+  if((flags & ~(MAP_SHARED|MAP_PRIVATE|MAP_ANON)) != 0 ||
+     (type != MAP_SHARED && type != MAP_PRIVATE))
+    return -1;
+  if(flags & MAP_ANON)
+    f = 0;
+  else {
+    if(f == 0 || f->type != FD_INODE || !f->readable)
+      return -1;
+    if(type == MAP_SHARED && (prot & PROT_WRITE) && !f->writable)
+      return -1;
+    ilock(f->ip);
+    type = f->ip->type;
+    iunlock(f->ip);
+    if(type != T_FILE)
+      return -1;
+  }
+
+  acquiresleep(&mmtab.lock);
+  if((addr = findhole(curproc->pgdir, len)) == 0 || (v = allocvma()) == 0){
+    releasesleep(&mmtab.lock);
+    return -1;
+  }
+  v->pgdir = curproc->pgdir;
+  v->addr = addr;
+  v->len = len;
+  v->prot = prot;
+  v->flags = flags;
+  v->f = f ? filedup(f) : 0;
+  v->off = off;
+  v->obj = 0;
+  if(flags & MAP_SHARED)
+    v->obj = f ? (uint)f->ip : mmtab.nextanon++;
+  releasesleep(&mmtab.lock);
+  return addr;
+}
+
+// [addr, addr+len) 의 mapping 을 없앤다. mapping 의 일부만 없애면 남은 부분은 그대로 쓸 수 있다.
+int
+munmap(uint addr, uint len)
+{
+  struct proc *curproc = myproc();
+  struct vma *v, *nv;
+  uint end, s, e;
+
+  len = PGROUNDUP(len);
+  end = addr + len;
+  if(addr % PGSIZE != 0 || len == 0 || end < addr)
+    return -1;
+
+  acquiresleep(&mmtab.lock);
+  for(v = mmtab.vma; v < &mmtab.vma[NVMA]; v++){
+    if(v->pgdir != curproc->pgdir || end <= v->addr || v->addr + v->len <= addr)
+      continue;
+    s = addr > v->addr ? addr : v->addr;
+    e = end < v->addr + v->len ? end : v->addr + v->len;
+    if(s > v->addr && e < v->addr + v->len){
+      // 가운데를 없애면 뒷부분은 새 mapping 이 된다
+      if((nv = allocvma()) == 0){
+        releasesleep(&mmtab.lock);
+        return -1;
+      }
+      *nv = *v;
+      nv->addr = e;
+      nv->len = v->addr + v->len - e;
+      nv->off = v->off + (e - v->addr);
+      if(nv->f)
+        filedup(nv->f);
+      unmaprange(v, s, e);
+      v->len = s - v->addr;
+    } else {
+      unmaprange(v, s, e);
+      if(s == v->addr && e == v->addr + v->len)
+        freevma(v);
+      else if(s == v->addr){
+        v->off += e - v->addr;
+        v->len -= e - v->addr;
+        v->addr = e;
+      } else
+        v->len = s - v->addr;
+    }
+  }
+  releasesleep(&mmtab.lock);
+  return 0;
+}
+
+// mmap 한 영역의 va 에서 난 페이지 폴트 (proc.c 의 pagefault). err 는 페이지 폴트의 error code 다.
+// prot 가 허락하는 접근이면 없는 페이지를 0 으로 채우거나 파일에서 읽어 넣는다 (이미 있으면 그대로).
+// 허락하지 않는 접근이 사용자 모드에서 났으면 -1, 커널에서 났으면 discardfault 로 처리한다.
+// va 가 mapping 밖이거나 메모리가 모자라도 -1.
+// sleeplock 을 잡고 TLB shootdown 을 기다리므로 다른 lock 을 잡은 채로 부르면 안 된다.
+// 커널이 lock 을 잡은 채 사용자 메모리에 쓰다가 여기로 오지 않도록, 그런 버퍼는
+// 시스템 호출 입구에서 argoutptr 로 미리 채워 두고 lock 을 놓은 뒤에 쓴다.
+int
+mmapfault(uint va, uint err)
+{
+  struct proc *curproc = myproc();
+  struct vma *v;
+  int r, ok;
+
+  pushcli();
+  if(mycpu()->ncli > 1)
+    panic("mmapfault locks");
+  popcli();
+
+  va = PGROUNDDOWN(va);
+  acquiresleep(&mmtab.lock);
+  if((v = findvma(curproc->pgdir, va)) == 0){
+    releasesleep(&mmtab.lock);
+    return -1;
+  }
+  if(err & FEC_WR)
+    ok = v->prot & PROT_WRITE;
+  else
+    ok = v->prot & (PROT_READ|PROT_WRITE);
+  if(!ok)
+    r = (err & FEC_U) ? -1 : discardfault(v, va);
+  else if(uvmpage(v->pgdir, va, 0) != 0)
+    r = 0;
+  else
+    r = fillfault(v, va);
+  releasesleep(&mmtab.lock);
+  return r;
+}
+
+// va 를 포함하는 mapping 의 끝 주소. 없으면 0. 시스템 호출 인자 검사에 쓴다 (syscall.c).
+uint
+mmapend(uint va)
+{
+  struct vma *v;
+  uint end;
+
+  acquiresleep(&mmtab.lock);
+  end = (v = findvma(myproc()->pgdir, va)) != 0 ? v->addr + v->len : 0;
+  releasesleep(&mmtab.lock);
+  return end;
+}
+
+// fork 한 자식의 주소 공간 to 에 from 의 mapping 을 물려준다. MAP_SHARED 는 페이지를 넣지 않고
+// 자식이 폴트를 낼 때 공유 페이지 표에서 같은 페이지를 찾아 넣는다. MAP_PRIVATE 는 채운 페이지를
+// 복사한다. 실패하면 -1 이고, 물려준 것은 munmapall 로 없앤다.
+int
+mmapfork(pde_t *from, pde_t *to)
+{
+  struct vma *v, *nv;
+  char *mem, *pmem;
+  uint a;
+  int perm;
+
+  acquiresleep(&mmtab.lock);
+  for(v = mmtab.vma; v < &mmtab.vma[NVMA]; v++){
+    if(v->pgdir != from)
+      continue;
+    if((nv = allocvma()) == 0)
+      goto bad;
+    *nv = *v;
+    nv->pgdir = to;
+    if(nv->f)
+      filedup(nv->f);
+    if(v->flags & MAP_SHARED)
+      continue;
+    perm = PTE_U | ((v->prot & PROT_WRITE) ? PTE_W : 0);
+    for(a = v->addr; a < v->addr + v->len; a += PGSIZE){
+      if((pmem = uvmpage(from, a, 0)) == 0)
+        continue;
+      if((mem = kalloc()) == 0)
+        goto bad;
+      memmove(mem, pmem, PGSIZE);
+      if(uvmmap(to, a, mem, perm) < 0){
+        kfree(mem);
+        goto bad;
+      }
+    }
+  }
+  releasesleep(&mmtab.lock);
+  return 0;
+
+bad:
+  releasesleep(&mmtab.lock);
+  return -1;
+}
+
+// pgdir 의 mapping 을 모두 없앤다. 주소 공간을 버리기 전에 부른다 (exit, exec, fork 실패).
+void
+munmapall(pde_t *pgdir)
+{
+  struct vma *v;
+
+  acquiresleep(&mmtab.lock);
+  for(v = mmtab.vma; v < &mmtab.vma[NVMA]; v++){
+    if(v->pgdir != pgdir)
+      continue;
+    unmaprange(v, v->addr, v->addr + v->len);
+    freevma(v);
+  }
+  releasesleep(&mmtab.lock);
+}
@@ -0,0 +1,13 @@
+// mmap/munmap 의 인자 (커널과 사용자 프로그램이 함께 쓴다)
+
+#define PROT_READ   0x1
+#define PROT_WRITE  0x2
+
+#define MAP_SHARED  0x01  // 쓴 내용을 파일에 돌려 쓰고, fork 한 자식과 페이지를 함께 쓴다
+#define MAP_PRIVATE 0x02  // 쓴 내용은 자기만 본다
+#define MAP_ANON    0x20  // 파일 없이 0 으로 채운 메모리 (fd, off 는 쓰지 않는다)
+
+#define MAP_FAILED  ((void*)-1)
+
+// mmap 한 영역은 MMAPBASE 부터 KERNBASE 아래에 두고, sbrk 로 늘리는 힙은 MMAPBASE 아래까지만 자란다
+#define MMAPBASE    0x40000000
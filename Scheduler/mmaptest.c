@@ -0,0 +1,57 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "mmap.h"
+
+// lseektest 와 같은 일을 read/lseek/write 대신 mmap 으로 하는 프로그램.
+// 파일을 MAP_SHARED 로 비추어 내용을 출력하고, offset 위치에 string 을 메모리로 바로 쓴 뒤
+// munmap 으로 파일에 돌려 쓰고 read 로 다시 읽어 확인한다.
+
+int main(int argc, char **argv) {
+  int fd, offset, len, n;
+  struct stat st;
+  char *p, buf[512];
+
+  if(argc < 4) { // 입력 방식이 잘못됐을 경우 에러처리
+    printf(2, "usage : mmaptest <filename> <offset> <string>\n");
+    exit();
+  }
+
+  fd = open(argv[1], O_RDWR);
+  if(fd < 0 || fstat(fd, &st) < 0 || st.size == 0) { // 파일이 열리지 않거나 비어 있을 경우 에러처리
+    printf(2, "open error for %s\n", argv[1]);
+    exit();
+  }
+
+  p = mmap(0, st.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(p == MAP_FAILED) {
+    printf(2, "mmap error\n");
+    exit();
+  }
+
+  printf(1, "Before : ");
+  write(1, p, st.size); // 비춘 메모리를 그대로 출력
+  printf(1, "\n");
+
+  offset = atoi(argv[2]);
+  len = strlen(argv[3]);
+  if(offset + len > st.size) { // mmap 으로는 파일 크기를 늘릴 수 없다
+    printf(2, "offset error\n");
+    exit();
+  }
+  memmove(p + offset, argv[3], len);
+
+  if(munmap(p, st.size) < 0) {
+    printf(2, "munmap error\n");
+    exit();
+  }
+
+  printf(1, "After : ");
+  while((n = read(fd, buf, sizeof(buf))) > 0)
+    write(1, buf, n);
+  printf(1, "\n");
+
+  close(fd);
+  exit();
+}
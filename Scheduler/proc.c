@@ -6,26 +6,122 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
-#include <stddef.h>
-
-
+#include "sleeplock.h"
+#include "mcslock.h"
+#include "traps.h"
+#include "sched.h"
+#include "mlfq.h"
+#include "schedclass.h"
+#include "spawn.h"
+#include "mmap.h"
+
+// 잠금 (먼저 잡는 것부터):
+//   vmlock → waitlock → pidlock → sleepq[].lock → p->lock → edflock → runq lock
+// - p->lock: 프로세스의 state, chan, killed 와 스케줄링 필드 (class, q_level, cpu 등)를
+//   보호한다. sched() 를 부를 때 잡고 있어야 하며, 스케줄러는 swtch 가 끝난 뒤에 놓는다.
+//   두 프로세스의 lock 을 함께 잡는 것은 fork/clone 뿐이고, 부모 것을 먼저 잡는다.
+// - waitlock: parent, children, sibling 을 보호한다. 프로세스는 이 lock 을 잡은 채로
+//   ZOMBIE 가 되므로 wait 이 자식의 상태를 보고 잠드는 사이에 깨우는 것을 놓치지 않는다.
+// - pidlock: UNUSED 슬롯 목록, pid 해시, nextpid 를 보호한다. 슬롯을 UNUSED 로 돌려줄 때
+//   p->lock 도 잡으므로, p->lock 을 잡은 동안에는 슬롯이 다른 프로세스에게 가지 않는다.
+// - sleepq[].lock: 잠든 프로세스 버킷. 잠드는 쪽은 원래 lock 을 놓기 전에 버킷에 들어가고
+//   깨우는 쪽은 버킷을 보며 p->lock 을 잡으므로 wakeup 을 잃지 않는다.
+// - 실행 큐에 들어 있는 동안 p->cpu 와 클래스의 큐 필드는 그 큐의 lock 이 보호한다 (runqlock).
+// waitlock 은 sleep 에 넘기므로 spinlock 이고, 나머지는 MCS 큐 lock (mcslock.c) 이다.
 struct {
-  struct spinlock lock;
   struct proc proc[NPROC];
+  struct mcslock plock[NPROC];  // ptable.proc[i].lock 이 가리키는 lock
 } ptable;
 
+struct runq runqs[NCPU];
+
+// class 번호로 찾는 스케줄링 클래스와, 다음 프로세스를 고를 때 물어보는 순서.
+static struct schedclass *classes[NSCHEDCLASS] = {
+  [SCHED_MLFQ]   &mlfqclass,
+  [SCHED_STRIDE] &strideclass,
+  [SCHED_CFS]    &cfsclass,
+  [SCHED_EDF]    &edfclass,
+};
+static int classorder[] = {
+  SCHED_EDF,
+  SCHED_STRIDE,
+  SCHED_CFS,
+  SCHED_MLFQ,
+};
+
+// 잠든 프로세스를 chan 값으로 나눠 담는 해시 테이블.
+// 같은 버킷의 프로세스는 p->snext/p->sprev 로 연결되며 버킷의 lock 으로 보호한다.
+#define NSLEEPQ 64
+#define SLEEPHASH(chan) ((((uint)(chan)) * 2654435761U) >> 26)  // 상위 6비트
+
+struct sleepq {
+  struct mcslock lock;
+  struct proc *head;
+};
+static struct sleepq sleepq[NSLEEPQ];
+
+// UNUSED 상태의 프로세스 슬롯 목록 (p->qnext 로 연결)과 pid 로 프로세스를
+// 찾는 해시 테이블 (p->pidnext 로 연결). 둘 다 pidlock 으로 보호한다.
+#define NPIDHASH 64
+#define PIDHASH(pid) ((pid) & (NPIDHASH-1))
+
+static struct mcslock pidlock;
+static struct proc *freeproc;
+static struct proc *pidhash[NPIDHASH];
+
+static struct spinlock waitlock;
+
 static struct proc *initproc;
 
+// 같은 pgdir 을 쓰는 스레드들이 동시에 주소 공간의 크기를 바꾸지 못하게 한다 (growproc).
+static struct mcslock vmlock;
+
+// growproc 을 한 번에 하나만 하게 한다. 줄인 범위의 페이지는 vmlock 을 놓고 다른 CPU 의
+// TLB 를 비운 뒤에 해제하는데 (tlbshootdown), 그 사이에 다른 스레드가 다시 늘려
+// 지운 PTE 위에 새 페이지를 채우지 못하도록 늘릴 때도 잡는다.
+// 기다리는 동안 인터럽트를 받아야 하므로 sleeplock 이다.
+static struct sleeplock sizelock;
+
+// TSC 로 잰 1 tick 의 cycle 수. CPU 0 의 타이머 인터럽트 간격으로 잰다 (schedtick).
+uint cycpertick;
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
+static void runqadd(struct proc *p, int front);
+static int schedleave(struct proc *p);
+static void schedready(void);
+static void runqtake(struct runq *rq, struct proc *p);
+static void sleepqremove(struct sleepq *sq, struct proc *p);
+static void schedfork(struct proc *parent, struct proc *p);
 
 void
 pinit(void)
 {
-  initlock(&ptable.lock, "ptable");
+  struct proc *p;
+  int i;
+
+  mcsinit(&pidlock, "pid");
+  initlock(&waitlock, "wait");
+  mcsinit(&vmlock, "vm");
+  initsleeplock(&sizelock, "size");
+  for(p = &ptable.proc[NPROC-1]; p >= ptable.proc; p--){
+    p->lock = &ptable.plock[p - ptable.proc];
+    mcsinit(p->lock, "proc");
+    p->qnext = freeproc;
+    freeproc = p;
+  }
+  for(i = 0; i < NSLEEPQ; i++)
+    mcsinit(&sleepq[i].lock, "sleepq");
+  mlfqinit();
+  edfinit();
+  mmapinit();
+  schedtraceinit();
+  for(i = 0; i < NCPU; i++){
+    mcsinit(&runqs[i].lock, "runq");
+    cpus[i].rq = &runqs[i];
+  }
 }
 
 // Must be called with interrupts disabled
@@ -54,16 +150,6 @@ mycpu(void)
   panic("unknown apicid\n");
 }
 
-int time_quantum[4] = {10, 20, 40, 80};
-struct proc* Q0[64];
-struct proc* Q1[64];
-struct proc* Q2[64];
-struct proc* Q3[64];
-int qP0 = -1;
-int qP1 = -1;
-int qP2 = -1;
-int qP3 = -1;
-
 // Disable interrupts so that we are not rescheduled
 // while reading proc from the cpu structure
 struct proc*
@@ -78,6 +164,65 @@ myproc(void) {
   return p;
 }
 
+// pid 에 해당하는 프로세스를 찾는다. 없으면 0. pidlock 을 잡고 호출해야 한다.
+static struct proc*
+pidlookup(int pid)
+{
+  struct proc *p;
+
+  for(p = pidhash[PIDHASH(pid)]; p; p = p->pidnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// pid 프로세스 (0 이면 자신)를 찾아 p->lock 을 잡은 채로 돌려준다. 없으면 0.
+static struct proc*
+proclock(int pid)
+{
+  struct proc *p;
+
+  if(pid == 0){
+    p = myproc();
+    mcsacquire(p->lock);
+    return p;
+  }
+  mcsacquire(&pidlock);
+  if((p = pidlookup(pid)) != 0)
+    mcsacquire(p->lock);
+  mcsrelease(&pidlock);
+  return p;
+}
+
+// 프로세스 슬롯을 pid 해시에서 빼고 UNUSED 로 만들어 free list 에 돌려준다.
+// pidlock 을 잡고 호출해야 한다.
+static void
+procfree(struct proc *p)
+{
+  struct proc **pp;
+
+  mcsacquire(p->lock);
+
+  for(pp = &pidhash[PIDHASH(p->pid)]; *pp; pp = &(*pp)->pidnext){
+    if(*pp == p){
+      *pp = p->pidnext;
+      break;
+    }
+  }
+  p->pidnext = 0;
+  p->pid = 0;
+  p->pgdir = 0;
+  p->parent = 0;
+  p->children = 0;
+  p->sibling = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+  p->qnext = freeproc;
+  freeproc = p;
+  mcsrelease(p->lock);
+}
+
 //PAGEBREAK: 32
 // Look in the process table for an UNUSED proc.
 // If found, change state to EMBRYO and initialize
@@ -89,24 +234,27 @@ allocproc(void)
   struct proc *p; // 프로세스 구조체 선언
   char *sp;
 
-  acquire(&ptable.lock); // 테이블 락 획득
+  mcsacquire(&pidlock); // pid 락 획득
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) // 반복문을 통해 UNUSED 상태의 프로세스 탐색
-    if(p->state == UNUSED)
-      goto found; // 찾으면 found 로 goto
-
-  release(&ptable.lock); // 락 해제
-  return 0;
+  if((p = freeproc) == 0){ // free list 에서 UNUSED 상태의 프로세스를 꺼낸다
+    mcsrelease(&pidlock); // 락 해제
+    return 0;
+  }
+  freeproc = p->qnext;
+  p->qnext = 0;
 
-found:
   p->state = EMBRYO; // 프로세스 상태를 EMBRYO 설정
   p->pid = nextpid++; // 고유한 프로세스 pid 를 할당
+  p->pidnext = pidhash[PIDHASH(p->pid)]; // pid 해시에 등록
+  pidhash[PIDHASH(p->pid)] = p;
 
-  release(&ptable.lock); // 락 해제
+  mcsrelease(&pidlock); // 락 해제
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){  // 커널 스택을 할당
-    p->state = UNUSED; // 0인 경우 상태 UNUSED 로 설정하고 리턴
+    mcsacquire(&pidlock); // 0인 경우 슬롯을 돌려주고 리턴
+    procfree(p);
+    mcsrelease(&pidlock);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE; // 커널 스택의 최상단 주소 설정
@@ -132,20 +280,24 @@ found:
   p->cpu_wait = 0; // RUNNABLE 이후 큐에서 대기시간 0 으로 초기화
   p->io_wait_time = 0; // SLEEPING 시간 0 으로 초기화
   p->ticks = 0; 
-
-  if(p->pid == 0 || p->pid == 1 || p->pid == 2) {
-    p->q_level = 3; // 처음 프로세스는 우선 순위가 제일 높은 큐로 초기화
-    
-    qP3++;
-    Q3[qP3] = p;
-  }
-  else {
-    p->q_level = 0; // 처음 프로세스는 우선 순위가 제일 높은 큐로 초기화
-    qP0++; // 0번째 큐의 인덱스 값을 하나 늘리고 새로운 프로세스 대입
-    
-    Q0[qP0] = p;
-
-  }
+  p->cpu = -1; // 실행 큐는 RUNNABLE 이 될 때 정한다
+  p->nswtch = 0;
+  p->stamp = rdtsc();
+  p->runcyc = p->waitcyc = p->sleepcyc = p->runrem = 0;
+  p->ivrun = p->ivslp = 0;
+  p->affinity = ~0; // 모든 CPU
+  p->load = 0;
+  p->lastrun = 0;
+  p->nmigrate = 0;
+  p->thread = 0;
+  p->ustack = 0;
+
+  p->onrq = 0;
+  p->tickets = 0;
+  p->nice = 0;
+  p->edfruntime = p->edfdeadline = p->edfperiod = 0;
+  p->edfmiss = p->edfheld = 0;
+  p->pass = 0; // 스케줄링 클래스와 q_level 은 RUNNABLE 이 되기 전에 schedfork 가 정한다
 
   return p;
 }
@@ -181,11 +333,13 @@ userinit(void)
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
+  mcsacquire(p->lock);
 
+  schedfork(0, p);
   p->state = RUNNABLE;
+  runqadd(p, 0);
 
-  release(&ptable.lock);
+  mcsrelease(p->lock);
 }
 
 // Grow current process's memory by n bytes.
@@ -193,19 +347,182 @@ userinit(void)
 int
 growproc(int n)
 {
-  uint sz;
+  uint sz, oldsz;
   struct proc *curproc = myproc();
+  struct proc *p;
 
-  sz = curproc->sz;
+  acquiresleep(&sizelock);
+  mcsacquire(&vmlock);
+  oldsz = sz = curproc->sz;
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    // 주소 범위만 늘린다. 페이지는 처음 쓸 때 pagefault 가 할당한다.
+    if(sz + n < sz || sz + n > MMAPBASE){
+      mcsrelease(&vmlock);
+      releasesleep(&sizelock);
       return -1;
+    }
+    sz += n;
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    // 할당된 적이 있는 페이지만 뺀다. 해제는 다른 CPU 의 TLB 를 비운 뒤에 한다.
+    if(sz + n > sz){
+      mcsrelease(&vmlock);
+      releasesleep(&sizelock);
       return -1;
+    }
+    sz += n;
+    uvmzap(curproc->pgdir, sz, oldsz);
+  }
+  // 같은 주소 공간을 쓰는 스레드들의 크기도 함께 바꾼다.
+  // 스레드의 pgdir 과 sz 는 vmlock 을 잡고 정하므로 (clone) 빠지는 스레드가 없다.
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state != UNUSED && p->pgdir == curproc->pgdir)
+      p->sz = sz;
+  mcsrelease(&vmlock);
+  if(n < 0){
+    tlbshootdown(curproc->pgdir);
+    mcsacquire(&vmlock);
+    uvmreap(curproc->pgdir, sz, oldsz);
+    mcsrelease(&vmlock);
   }
-  curproc->sz = sz;
-  switchuvm(curproc);
+  releasesleep(&sizelock);
+  return 0;
+}
+
+// 다른 CPU 가 c 에 보낸 TLB 요청이 남아 있으면 지금 쓰고 있는 페이지 테이블을 다시 읽는다.
+// 비우기 전에 읽은 요청까지만 끝났다고 알리므로, 그 뒤에 온 요청은 다음 번에 처리한다.
+// 인터럽트를 끈 상태에서 부른다.
+static void
+tlbflushreq(struct cpu *c)
+{
+  uint req = c->tlbreq;
+
+  if(c->tlbdone == req)
+    return;
+  __sync_synchronize();
+  lcr3(rcr3());
+  __sync_synchronize();
+  c->tlbdone = req;
+}
+
+// pgdir 의 PTE 를 바꾼 뒤 부른다. 이 CPU 와, 지금 pgdir 로 돌고 있는 다른 CPU 의 TLB 를
+// IPI 로 비우고 모두 비울 때까지 기다린다. 두 CPU 가 동시에 서로에게 보내도 기다리는 동안
+// 자기에게 온 요청을 처리하므로 인터럽트가 꺼져 있어도 (페이지 폴트 처리 중) 된다.
+// 다른 CPU 가 인터럽트를 끄고 기다릴 수 있는 lock (spinlock, mcslock) 은 잡지 않고 부른다.
+// 확인한 뒤에 pgdir 로 바꾸는 CPU 는 cr3 를 새로 쓰므로 옛 TLB 항목을 갖고 있지 않다.
+void
+tlbshootdown(pde_t *pgdir)
+{
+  struct cpu *c, *me;
+  struct proc *p;
+  uint req[NCPU];
+
+  pushcli();
+  me = mycpu();
+  if(me->proc && me->proc->pgdir == pgdir)
+    lcr3(V2P(pgdir));
+  for(c = cpus; c < &cpus[ncpu]; c++){
+    req[c - cpus] = 0;
+    if(c == me || (p = c->proc) == 0 || p->pgdir != pgdir)
+      continue;
+    req[c - cpus] = __sync_add_and_fetch(&c->tlbreq, 1);
+    lapicipi(c->apicid, T_IRQ0 + IRQ_TLB);
+  }
+  for(c = cpus; c < &cpus[ncpu]; c++)
+    while(req[c - cpus] && (int)(c->tlbdone - req[c - cpus]) < 0)
+      tlbflushreq(me);
+  popcli();
+}
+
+// IRQ_TLB 인터럽트 (trap.c)
+void
+tlbintr(void)
+{
+  tlbflushreq(mycpu());
+}
+
+// 사용자 주소 va 에서 난 페이지 폴트를 처리한다 (trap.c). sbrk 로 늘렸지만 아직 쓰지 않은
+// 페이지면 0 으로 채운 페이지를 할당하고, fork 뒤에 함께 쓰는 쓰기 시 복사 페이지면 복사한다.
+// mmap 한 영역은 err (페이지 폴트의 error code) 로 prot 를 검사하는 mmapfault 가 처리한다.
+// 처리했으면 0, 그런 페이지가 아니거나 메모리가 모자라면 -1.
+// 스레드가 같은 페이지에서 동시에 폴트를 낼 수 있으므로 vmlock 을 잡고 한다.
+int
+pagefault(uint va, uint err)
+{
+  struct proc *curproc = myproc();
+  int r;
+
+  if(va >= MMAPBASE)
+    return mmapfault(va, err);
+  mcsacquire(&vmlock);
+  r = lazyfault(curproc->pgdir, va, curproc->sz);
+  if(r == 0)
+    r = cowfault(curproc->pgdir, va);
+  mcsrelease(&vmlock);
+  return r;
+}
+
+// [va, va+n) 에서 아직 할당하지 않은 페이지를 미리 채우고, 쓰기 시 복사 페이지는 copyout 처럼
+// 미리 자기 것으로 만든다. 시스템 호출 안에서 사용자 메모리를 쓰다 폴트가 났을 때 메모리가
+// 모자라면 copyuser 밖에서는 되돌릴 방법이 없으므로 (trap.c 에서 panic), 커널이 쓸 버퍼는
+// 미리 채워 두고 실패하면 시스템 호출이 -1 을 돌려주게 한다 (argptr). write 가 0 이 아니면 커널이 쓸 버퍼라서
+// mmap 영역을 쓰기 폴트로 채우므로, 쓸 수 없는 mapping 이면 -1 이다 (argoutptr).
+int
+pagein(uint va, uint n, int write)
+{
+  struct proc *curproc = myproc();
+  uint a;
+  int r;
+
+  r = 0;
+  for(a = PGROUNDDOWN(va); r == 0 && a < va + n; a += PGSIZE){
+    if(a >= MMAPBASE){
+      r = mmapfault(a, FEC_U | (write ? FEC_WR : 0)); // 사용자가 접근할 수 없는 버퍼면 시스템 호출이 실패한다
+      continue;
+    }
+    mcsacquire(&vmlock);
+    r = lazyfault(curproc->pgdir, a, curproc->sz);
+    if(r == 0)
+      r = cowfault(curproc->pgdir, a);
+    mcsrelease(&vmlock);
+  }
+  return r;
+}
+
+// p 말고도 p 의 주소 공간을 쓰는 프로세스 (스레드) 가 있는지. pidlock 을 잡고 부른다.
+static int
+vmshared(struct proc *p)
+{
+  struct proc *q;
+
+  for(q = ptable.proc; q < &ptable.proc[NPROC]; q++)
+    if(q != p && q->state != UNUSED && q->pgdir == p->pgdir)
+      return 1;
+  return 0;
+}
+
+// 현재 프로세스가 주소 공간을 다른 스레드와 함께 쓰고 있으면 1 (exec).
+int
+vmsharing(void)
+{
+  int shared;
+
+  mcsacquire(&pidlock);
+  shared = vmshared(myproc());
+  mcsrelease(&pidlock);
+  return shared;
+}
+
+// p 말고 p 의 주소 공간을 쓰면서 아직 끝나지 않은 (ZOMBIE 가 아닌) 프로세스가 있는지.
+// exit 에서 ZOMBIE 가 되는 것은 waitlock 안이므로 waitlock 을 잡고 부르면,
+// 함께 끝나는 스레드 중 하나만 자기가 마지막임을 본다.
+static int
+vmlive(struct proc *p)
+{
+  struct proc *q;
+
+  for(q = ptable.proc; q < &ptable.proc[NPROC]; q++)
+    if(q != p && q->state != UNUSED && q->state != ZOMBIE && q->pgdir == p->pgdir)
+      return 1;
   return 0;
 }
 
@@ -215,7 +532,7 @@ growproc(int n)
 int
 fork(void)
 {
-  int i, pid;
+  int i, pid, shared;
   struct proc *np;
   struct proc *curproc = myproc();
 
@@ -225,14 +542,30 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+  // 페이지는 쓰기 시 복사로 함께 쓴다. 스레드가 여럿이면 부모의 페이지를 읽기 전용으로
+  // 바꿀 때마다 다른 CPU 에서 도는 스레드의 TLB 를 비워야 하므로 (cowfault 는 이 CPU 만
+  // 비운다) 바로 복사한다.
+  mcsacquire(&pidlock);
+  shared = vmshared(curproc);
+  mcsrelease(&pidlock);
+  if(shared)
+    np->pgdir = copyuvm(curproc->pgdir, curproc->sz);
+  else
+    np->pgdir = cowuvm(curproc->pgdir, curproc->sz);
+  // mmap 한 영역도 물려준다
+  if(np->pgdir == 0 || mmapfork(curproc->pgdir, np->pgdir) < 0){
+    if(np->pgdir){
+      munmapall(np->pgdir);
+      freevm(np->pgdir);
+    }
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    mcsacquire(&pidlock);
+    procfree(np);
+    mcsrelease(&pidlock);
     return -1;
   }
   np->sz = curproc->sz;
-  np->parent = curproc;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -242,16 +575,25 @@ fork(void)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  np->affinity = curproc->affinity;
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
   pid = np->pid;
 
-  acquire(&ptable.lock);
+  acquire(&waitlock);
+  np->parent = curproc;
+  np->sibling = curproc->children; // 부모의 자식 목록에 연결
+  curproc->children = np;
+  release(&waitlock);
 
+  mcsacquire(curproc->lock); // 부모의 스케줄링 필드를 물려받는다
+  mcsacquire(np->lock);
+  schedfork(curproc, np);
   np->state = RUNNABLE;
-
-  release(&ptable.lock);
+  runqadd(np, 0);
+  mcsrelease(np->lock);
+  mcsrelease(curproc->lock);
 
   if(pid >= 4) {
     #ifdef DEBUG
@@ -261,6 +603,184 @@ fork(void)
   return pid;
 }
 
+// 부모와 pgdir, 열린 파일, 작업 디렉토리를 함께 쓰는 스레드를 만든다.
+// 스레드는 stack 이 가리키는 한 페이지를 사용자 스택으로 써서 fcn(arg1, arg2) 부터
+// 실행한다. fcn 이 돌아오면 가짜 return 주소 0xffffffff 로 가서 죽으므로 exit() 로 끝내야 한다.
+// 스케줄링 클래스와 MLFQ 단계 같은 스케줄링 상태는 스레드마다 따로 가진다.
+int
+clone(void (*fcn)(void*, void*), void *arg1, void *arg2, void *stack)
+{
+  int i, pid, shared;
+  uint sp, ustack[3];
+  struct proc *np;
+  struct proc *curproc = myproc();
+
+  if((uint)stack % PGSIZE != 0 || (uint)stack + PGSIZE > curproc->sz)
+    return -1;
+  // 처음 만드는 스레드면 fork 뒤에 남은 쓰기 시 복사 페이지를 먼저 자기 것으로 만든다
+  mcsacquire(&pidlock);
+  shared = vmshared(curproc);
+  mcsrelease(&pidlock);
+  if(!shared && cowbreak(curproc->pgdir, curproc->sz) < 0)
+    return -1;
+  if((np = allocproc()) == 0)
+    return -1;
+
+  mcsacquire(&vmlock);
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  mcsrelease(&vmlock);
+  np->thread = 1;
+  np->ustack = (uint)stack;
+  *np->tf = *curproc->tf;
+
+  ustack[0] = 0xffffffff;  // 가짜 return PC
+  ustack[1] = (uint)arg1;
+  ustack[2] = (uint)arg2;
+  sp = (uint)stack + PGSIZE - sizeof(ustack);
+  if(pagein(sp, sizeof(ustack), 1) < 0 ||
+     copyout(np->pgdir, sp, ustack, sizeof(ustack)) < 0){
+    kfree(np->kstack);
+    np->kstack = 0;
+    mcsacquire(&pidlock);
+    procfree(np);
+    mcsrelease(&pidlock);
+    return -1;
+  }
+  np->tf->eip = (uint)fcn;
+  np->tf->esp = sp;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+  np->affinity = curproc->affinity;
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  pid = np->pid;
+
+  acquire(&waitlock);
+  np->parent = curproc;
+  np->sibling = curproc->children;
+  curproc->children = np;
+  release(&waitlock);
+
+  mcsacquire(curproc->lock);
+  mcsacquire(np->lock);
+  schedfork(curproc, np);
+  np->state = RUNNABLE;
+  runqadd(np, 0);
+  mcsrelease(np->lock);
+  mcsrelease(curproc->lock);
+
+  return pid;
+}
+
+// path 의 프로그램을 실행하는 자식 프로세스를 fork 와 exec 를 거치지 않고 바로 만든다.
+// 주소 공간은 부모의 것을 복사하거나 함께 쓰지 않고 ELF 에서 새로 만든다 (loadimage).
+// 열린 파일은 부모의 것을 물려준 뒤 fa 의 동작을 차례로 적용하고, attr 이 있으면
+// 스케줄링 상태를 그 값으로 정한 뒤에 RUNNABLE 로 만든다. fa, attr 은 0 이어도 된다.
+int
+spawn(char *path, char **argv, struct spawnfa *fa, struct spawnattr *attr)
+{
+  int i, fd, newfd, pid;
+  struct proc *np;
+  struct proc *curproc = myproc();
+  struct schedconfig sc;
+
+  if(fa && (fa->n < 0 || fa->n > NSPAWNFA))
+    return -1;
+  if(attr){
+    sched_getconfig(&sc);
+    if(attr->q_level < 0 || mlfq_clamp(&sc, attr->q_level) != attr->q_level ||
+       attr->end_time < 0)
+      return -1;
+  }
+
+  if((np = allocproc()) == 0)
+    return -1;
+  // fork 처럼 부모의 trapframe 을 물려받지 않으므로 userinit 처럼 처음부터 채운다
+  memset(np->tf, 0, sizeof(*np->tf));
+  np->tf->cs = (SEG_UCODE << 3) | DPL_USER;
+  np->tf->ds = (SEG_UDATA << 3) | DPL_USER;
+  np->tf->es = np->tf->ds;
+  np->tf->ss = np->tf->ds;
+  np->tf->eflags = FL_IF;
+  if(loadimage(np, path, argv) < 0)
+    goto bad;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  for(i = 0; fa && i < fa->n; i++){
+    fd = fa->act[i].fd;
+    newfd = fa->act[i].newfd;
+    if(fd < 0 || fd >= NOFILE || np->ofile[fd] == 0)
+      goto bad;
+    switch(fa->act[i].op){
+    case SPAWN_CLOSE:
+      fileclose(np->ofile[fd]);
+      np->ofile[fd] = 0;
+      break;
+    case SPAWN_DUP2:
+      if(newfd < 0 || newfd >= NOFILE)
+        goto bad;
+      if(newfd == fd)
+        break;
+      if(np->ofile[newfd])
+        fileclose(np->ofile[newfd]);
+      np->ofile[newfd] = filedup(np->ofile[fd]);
+      break;
+    default:
+      goto bad;
+    }
+  }
+  np->cwd = idup(curproc->cwd);
+  np->affinity = curproc->affinity;
+
+  pid = np->pid;
+
+  acquire(&waitlock);
+  np->parent = curproc;
+  np->sibling = curproc->children;
+  curproc->children = np;
+  release(&waitlock);
+
+  if(attr){
+    mcsacquire(np->lock);
+    schedfork(0, np);
+    np->q_level = attr->q_level;
+    np->end_time = attr->end_time;
+  } else {
+    mcsacquire(curproc->lock); // 부모의 스케줄링 필드를 물려받는다
+    mcsacquire(np->lock);
+    schedfork(curproc, np);
+    mcsrelease(curproc->lock);
+  }
+  np->state = RUNNABLE;
+  runqadd(np, 0);
+  mcsrelease(np->lock);
+
+  return pid;
+
+bad:
+  for(i = 0; i < NOFILE; i++){
+    if(np->ofile[i]){
+      fileclose(np->ofile[i]);
+      np->ofile[i] = 0;
+    }
+  }
+  if(np->pgdir)
+    freevm(np->pgdir);
+  kfree(np->kstack);
+  np->kstack = 0;
+  mcsacquire(&pidlock);
+  procfree(np);
+  mcsrelease(&pidlock);
+  return -1;
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
@@ -287,79 +807,521 @@ exit(void)
   end_op();
   curproc->cwd = 0; // 작업 디렉토리 초기화
 
-  acquire(&ptable.lock); // 테이블 락 획득
+  acquire(&waitlock); // ZOMBIE 가 될 때까지 부모가 자식 목록을 보지 못하게 한다
+
+  // 주소 공간을 쓰는 마지막 프로세스면 mmap 한 영역을 없애며 쓴 페이지를 파일에 돌려 쓴다.
+  // 파일을 쓰는 동안은 waitlock 을 놓는다. 다른 스레드는 모두 ZOMBIE 라 새로 생기지 않는다.
+  if(!vmlive(curproc)){
+    release(&waitlock);
+    munmapall(curproc->pgdir);
+    acquire(&waitlock);
+  }
 
   // Parent might be sleeping in wait().
-  wakeup1(curproc->parent); // 부모 프로세스가 잠들어 있을 수 있으니 깨운다
+  wakeup(curproc->parent); // 부모 프로세스가 잠들어 있을 수 있으니 깨운다
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){ // 현재 프로세스의 자식 프로세스를 init 프로세스로 양도
-    if(p->parent == curproc){ // 자식 프로세스인 경우
+  if(curproc->children){
+    for(p = curproc->children; ; p = p->sibling){ // 현재 프로세스의 자식 프로세스를 init 프로세스로 양도
       p->parent = initproc; // 부모의 init 프로세스 설정
       if(p->state == ZOMBIE) // 자식이 좀비인 경우
-        wakeup1(initproc); // init 프로세스 깨운다
+        wakeup(initproc); // init 프로세스 깨운다
+      if(p->sibling == 0)
+        break;
     }
+    p->sibling = initproc->children; // 자식 목록을 통째로 init 의 자식 목록 앞에 붙인다
+    initproc->children = curproc->children;
+    curproc->children = 0;
   }
 
   // Jump into the scheduler, never to return.
+  mcsacquire(curproc->lock);
+  schedleave(curproc);
   curproc->state = ZOMBIE; // 프로세스 상태를 좀비로 설정
+  schedtrace(SCHED_EXIT, curproc, curproc->cpu_burst - curproc->ticks);
+  release(&waitlock);
   sched(); // 스케줄러 호출
   panic("zombie exit"); // 패닉 상태로 전환
 }
 
+// 좀비 프로세스의 자원을 돌려준다. 주소 공간은 그것을 쓰는 마지막 프로세스나
+// 스레드를 거둘 때 해제한다. 부모가 먼저 끝나 init 이 거두는 스레드도 있으므로
+// 누가 마지막인지는 ptable 에서 같은 pgdir 을 쓰는 슬롯이 남았는지로 본다.
+// 슬롯을 돌려주는 것과 함께 pidlock 을 잡고 보므로 둘이 동시에 거둬도 한 번만 해제한다.
+// waitlock 을 잡고 부른다.
+static void
+reap(struct proc *p)
+{
+  int shared;
+  pde_t *pgdir = p->pgdir;
+
+  // 아직 sched() 에서 스케줄러로 넘어가는 중일 수 있다. 스케줄러가 p->lock 을
+  // 놓으면 이 커널 스택을 더 쓰지 않는다.
+  mcsacquire(p->lock);
+  mcsrelease(p->lock);
+  kfree(p->kstack);
+  p->kstack = 0;
+  mcsacquire(&pidlock);
+  shared = vmshared(p);
+  procfree(p);
+  mcsrelease(&pidlock);
+  if(!shared)
+    freevm(pgdir);
+}
+
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
 int
 wait(void)
 {
-  struct proc *p;
+  struct proc *p, **pp;
   int havekids, pid;
   struct proc *curproc = myproc();
   
-  acquire(&ptable.lock);
+  acquire(&waitlock);
   for(;;){
-    // Scan through table looking for exited children.
+    // Scan through the children list looking for exited children.
     havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
+    for(pp = &curproc->children; (p = *pp) != 0; pp = &p->sibling){
+      if(p->thread && p->pgdir == curproc->pgdir) // 자기 스레드는 join 으로 거둔다
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
         // Found one.
+        *pp = p->sibling; // 자식 목록에서 뺀다
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
-        release(&ptable.lock);
+        reap(p);
+        release(&waitlock);
         return pid;
       }
     }
 
     // No point waiting if we don't have any children.
     if(!havekids || curproc->killed){
-      release(&ptable.lock);
+      release(&waitlock);
+      return -1;
+    }
+
+    // Wait for children to exit.  (See wakeup call in proc_exit.)
+    sleep(curproc, &waitlock);  //DOC: wait-sleep
+  }
+}
+
+// 같은 주소 공간을 쓰는 자식 스레드 하나가 끝나기를 기다려 거두고 pid 를 돌려준다.
+// clone 에 넘겼던 사용자 스택 주소를 *stack 에 넣어 호출한 쪽이 해제할 수 있게 한다.
+int
+join(void **stack)
+{
+  struct proc *p, **pp;
+  int havekids, pid;
+  uint ustack;
+  struct proc *curproc = myproc();
+
+  acquire(&waitlock);
+  for(;;){
+    havekids = 0;
+    for(pp = &curproc->children; (p = *pp) != 0; pp = &p->sibling){
+      if(!p->thread || p->pgdir != curproc->pgdir)
+        continue;
+      havekids = 1;
+      if(p->state == ZOMBIE){
+        *pp = p->sibling;
+        pid = p->pid;
+        ustack = p->ustack;
+        reap(p);
+        release(&waitlock);
+        // 사용자 메모리에 쓰다 폴트가 날 수 있으므로 lock 을 놓은 뒤에 쓴다
+        if(copyuser(stack, &ustack, sizeof(ustack)) < 0)
+          return -1;
+        return pid;
+      }
+    }
+
+    if(!havekids || curproc->killed){
+      release(&waitlock);
       return -1;
     }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-    sleep(curproc, &ptable.lock);  //DOC: wait-sleep
+    sleep(curproc, &waitlock);
+  }
+}
+
+// p 가 마지막 상태 전환 뒤로 state 상태에서 보낸 시간을 TSC 로 재서 누적한다.
+// 실행 시간은 1 tick 이 찰 때마다 cpu_burst 에 더하므로, 타이머 인터럽트 직전에
+// 잠드는 프로세스도 쓴 만큼 청구된다. 상태를 바꾸기 직전에 호출한다.
+// p->lock 을 잡고 호출한다 (getprocinfo 가 64비트 누적값을 p->lock 을 잡고 읽는다).
+static void
+cycacct(struct proc *p, enum procstate state)
+{
+  uint64 now = rdtsc();
+  uint64 d = now - p->stamp;
+
+  p->stamp = now;
+  switch(state){
+  case RUNNING:
+    p->runcyc += d;
+    p->ivrun += d;
+    p->runrem += d;
+    while(cycpertick && p->runrem >= cycpertick){
+      p->runrem -= cycpertick;
+      p->cpu_burst++;
+    }
+    break;
+  case RUNNABLE:
+    p->waitcyc += d;
+    break;
+  case SLEEPING:
+    p->sleepcyc += d;
+    p->ivslp += d;
+    break;
+  default:
+    return;
+  }
+  if(cycpertick)
+    mlfq_decay(&p->ivrun, &p->ivslp, (uint64)MLFQ_HISTORY * cycpertick);
+}
+
+// hlt 로 쉬고 있는 CPU c 를 IPI 로 깨운다. idle 을 0 으로 바꾼 쪽만
+// IPI 를 보내므로 여러 CPU 가 동시에 깨워도 한 번만 보낸다.
+// 깨웠으면 1 을 돌려준다. 인터럽트를 끈 상태에서 호출해야 한다.
+static int
+cpuwake(struct cpu *c)
+{
+  if(c == mycpu() || !xchg(&c->idle, 0))
+    return 0;
+  lapicipi(c->apicid, T_IRQ0 + IRQ_WAKEUP);
+  return 1;
+}
+
+// 프로세스를 넣을 실행 큐의 CPU 를 고른다.
+// 캐시가 데워져 있을 마지막으로 실행된 CPU (p->cpu) 를 쓰되, 그 큐가 실행될 수 있는
+// CPU 중 가장 짧은 큐보다 AFFINITY_SLACK 개 넘게 길면 가장 짧은 큐로 옮긴다.
+// 아직 실행된 적 없거나 p->cpu 에서 실행될 수 없게 되었으면 가장 짧은 큐를 쓴다.
+#define AFFINITY_SLACK 2
+
+static int
+runqcpu(struct proc *p)
+{
+  int i, best;
+
+  best = cpuid();
+  for(i = 0; i < ncpu; i++)
+    if(CANRUN(p, i) && (!CANRUN(p, best) || runqs[i].nrun < runqs[best].nrun))
+      best = i;
+  if(p->cpu >= 0 && CANRUN(p, p->cpu) &&
+     runqs[p->cpu].nrun <= runqs[best].nrun + AFFINITY_SLACK)
+    return p->cpu;
+  return best;
+}
+
+// 프로세스가 CPU from 의 실행 큐에서 CPU to 의 실행 큐로 옮겨갔다.
+// CPU 별 수는 여러 CPU 가 함께 더하므로 lock 을 붙인 명령으로 더한다.
+static void
+migrated(struct proc *p, int from, int to)
+{
+  p->nmigrate++;
+  __sync_fetch_and_add(&cpus[from].nmigout, 1);
+  __sync_fetch_and_add(&cpus[to].nmigin, 1);
+}
+
+// 클래스의 큐에 넣고 실행 큐의 개수와 부하를 더한다. rq->lock 을 잡고 호출한다.
+static void
+runqput(struct runq *rq, struct proc *p, int front)
+{
+  classes[p->class]->enqueue(rq, p, front);
+  p->onrq = 1;
+  p->load = p->class == SCHED_CFS ? cfsweight(p->nice) : NICE0LOAD;
+  rq->load += p->load;
+  rq->nclass[p->class]++;
+  rq->nrun++;
+}
+
+// RUNNABLE 이 된 프로세스를 자기 클래스의 실행 큐에 넣는다. 큐는 runqcpu 가 고른다.
+// 그 CPU 가 쉬고 있으면 깨우고, 다른 프로세스를 실행 중이면 쉬고 있는 CPU 하나를
+// 깨워 훔쳐가게 한다. p->lock 을 잡고 호출해야 한다.
+static void
+runqadd(struct proc *p, int front)
+{
+  struct runq *rq;
+  struct cpu *c;
+  int i, from = p->cpu;
+
+  p->cpu = runqcpu(p);
+  if(from >= 0 && from != p->cpu)
+    migrated(p, from, p->cpu);
+  rq = &runqs[p->cpu];
+  mcsacquire(&rq->lock);
+  runqput(rq, p, front);
+  mcsrelease(&rq->lock);
+
+  // release 의 메모리 장벽 덕분에 cpuidle 과 nrun/idle 을 서로 반대 순서로
+  // 쓰고 읽으므로, 둘 중 적어도 하나는 상대가 쓴 값을 본다.
+  c = &cpus[p->cpu];
+  if(c->idle)
+    cpuwake(c);
+  else if(c->proc)
+    for(i = 0; i < ncpu; i++)
+      if(CANRUN(p, i) && cpus[i].idle && cpuwake(&cpus[i]))
+        break;
+}
+
+// 어느 실행 큐에도 프로세스가 없으면 다음 인터럽트까지 hlt 로 쉰다.
+// idle 을 먼저 1 로 쓰고 큐를 확인하므로, 그 뒤에 큐에 들어온 프로세스는
+// runqadd 가 IPI 로 깨워준다. 쉰 시간은 TSC 로 잰다.
+static void
+cpuidle(struct cpu *c)
+{
+  uint64 start;
+  int i;
+
+  cli();
+  c->idle = 1;
+  __sync_synchronize();
+  for(i = 0; i < ncpu; i++){
+    if(runqs[i].nrun > 0){
+      c->idle = 0;
+      return;
+    }
+  }
+  start = rdtsc();
+  stihlt();
+  cli();
+  c->idlecycles += rdtsc() - start;
+  c->idle = 0;
+}
+
+// 마지막으로 CPU 를 내려놓은 지 반 tick 이 안 된 프로세스는 이 CPU 의 캐시에
+// 작업 데이터가 남아 있다고 보고, 부하 분산으로 옮기지 않는다.
+int
+cachecold(struct proc *p)
+{
+  return rdtsc() - p->lastrun >= cycpertick / 2;
+}
+
+// 부하 분산. 타이머 인터럽트에서 CPU 마다 BALANCE_INTERVAL tick 에 한 번 부른다.
+// 가중치를 더한 부하(rq->load)가 가장 큰 CPU 의 큐에서 이 CPU 의 큐로 프로세스를 가져온다.
+// 바로 되돌아가며 흔들리지 않도록 그 큐의 부하가 이 큐보다 BALANCE_PCT% 넘게 크고
+// nice 0 프로세스 두 개 몫 넘게 차이날 때만 옮기고, 캐시가 식은 프로세스만 옮긴다.
+#define BALANCE_INTERVAL 4
+#define BALANCE_PCT      25
+#define BALANCE_MAXMOVE  2   // 한 번에 옮기는 프로세스 수
+
+static void
+balance(struct cpu *c)
+{
+  struct runq *rq = c->rq, *busiest;
+  struct proc *p;
+  int i, n = c - cpus, moved;
+
+  for(moved = 0; moved < BALANCE_MAXMOVE; moved++){
+    busiest = 0;
+    for(i = 0; i < ncpu; i++)
+      if(i != n && runqs[i].nrun > 0 && (busiest == 0 || runqs[i].load > busiest->load))
+        busiest = &runqs[i];
+    if(busiest == 0 || busiest->load * 100 <= rq->load * (100 + BALANCE_PCT) ||
+       busiest->load - rq->load <= 2 * NICE0LOAD)
+      return;
+
+    // 큐에 있는 프로세스의 p->cpu 는 큐의 lock 이 보호하므로 두 큐의 lock 만 잡는다.
+    // 두 큐의 lock 은 번호 순서대로 잡는다.
+    p = 0;
+    mcsacquire(busiest < rq ? &busiest->lock : &rq->lock);
+    mcsacquire(busiest < rq ? &rq->lock : &busiest->lock);
+    for(i = 0; i < NELEM(classorder) && p == 0; i++)
+      p = classes[classorder[i]]->steal(busiest, n, 1);
+    if(p){
+      runqtake(busiest, p);
+      migrated(p, busiest - runqs, n);
+      p->cpu = n;
+      runqput(rq, p, 0);
+    }
+    mcsrelease(&busiest->lock);
+    mcsrelease(&rq->lock);
+    if(p == 0)
+      return;
   }
 }
 
-typedef struct Node {
-  int q_level;
-  int idx;
-  int wait;
-} Node;
+// 타이머 인터럽트마다 모든 CPU 에서 불린다 (trap.c).
+// 실행 중인 프로세스에 지금까지 쓴 시간을 청구하고, 쉬고 있었으면 idle tick 을 센다.
+// BALANCE_INTERVAL tick 마다 CPU 별로 돌아가며 부하 분산을 한다.
+// CPU 0 은 타이머 인터럽트 사이의 TSC 차이로 cycpertick 을 고치고,
+// 클래스가 붙잡아 둔 프로세스 중 다시 실행할 때가 된 것을 실행 큐에 넣는다.
+void
+schedtick(void)
+{
+  static uint64 lasttsc;
+  struct cpu *c = mycpu();
+  struct proc *p;
+  uint64 now;
+  uint d;
+
+  if(c == &cpus[0]){
+    now = rdtsc();
+    if(lasttsc){
+      d = now - lasttsc;
+      cycpertick = cycpertick ? cycpertick - cycpertick/8 + d/8 : d;
+    }
+    lasttsc = now;
+    schedready();
+  }
 
-struct Node *AgingQ[64];
-int sigQ = 0;
-int sig_level = 0;
+  c->nticks++;
+  if(ncpu > 1 && (c->nticks + (c - cpus)) % BALANCE_INTERVAL == 0)
+    balance(c);
+  if((p = c->proc) != 0){
+    // 인터럽트가 켜져 있었으므로 이 CPU 는 p->lock 을 잡고 있지 않다
+    mcsacquire(p->lock);
+    if(p->state == RUNNING)
+      cycacct(p, RUNNING);
+    mcsrelease(p->lock);
+  } else if(c->idle)
+    c->idleticks++;
+}
+
+// 클래스가 큐에서 꺼낸 프로세스를 실행 큐의 개수에서 뺀다. rq->lock 을 잡고 호출한다.
+static void
+runqtake(struct runq *rq, struct proc *p)
+{
+  p->onrq = 0;
+  rq->load -= p->load;
+  rq->nclass[p->class]--;
+  rq->nrun--;
+}
+
+// 자신의 실행 큐에서 다음에 실행할 프로세스를 꺼낸다.
+// 클래스를 우선순위 순서대로 물어 처음으로 고른 프로세스를 쓴다.
+// 클래스에는 자기보다 낮은 클래스에서 기다리는 프로세스 수를 알려준다.
+static struct proc*
+runqpop(struct runq *rq)
+{
+  struct proc *p = 0;
+  int i, nbelow;
+
+  if(rq->nrun == 0)
+    return 0;
+  mcsacquire(&rq->lock);
+  nbelow = rq->nrun;
+  for(i = 0; i < NELEM(classorder) && p == 0; i++){
+    nbelow -= rq->nclass[classorder[i]];
+    p = classes[classorder[i]]->pick(rq, nbelow);
+  }
+  if(p)
+    runqtake(rq, p);
+  mcsrelease(&rq->lock);
+  return p;
+}
+
+// 자신의 실행 큐가 비었을 때 다른 CPU 의 큐에서 프로세스를 훔쳐온다.
+// 어떤 프로세스를 넘길지는 클래스가 정한다. 잠그는 것은 훔쳐오는 대상 큐의 lock 뿐이다.
+static struct proc*
+runqsteal(struct cpu *c)
+{
+  struct runq *rq;
+  struct proc *p;
+  int i, j, n;
+
+  n = c - cpus;
+  for(i = 1; i < ncpu; i++){
+    rq = &runqs[(n + i) % ncpu];
+    if(rq->nrun == 0)
+      continue;
+    p = 0;
+    mcsacquire(&rq->lock);
+    for(j = 0; j < NELEM(classorder) && p == 0; j++)
+      p = classes[classorder[j]]->steal(rq, n, 0);
+    if(p){
+      runqtake(rq, p);
+      migrated(p, rq - runqs, n);
+    }
+    mcsrelease(&rq->lock);
+    if(p)
+      return p;
+  }
+  return 0;
+}
+
+// 클래스마다 tick 에 한 번 할 일 (MLFQ 의 Aging 등)을 한다.
+static void
+runqtick(struct runq *rq)
+{
+  int i;
+
+  mcsacquire(&rq->lock);
+  for(i = 0; i < NELEM(classorder); i++)
+    if(classes[classorder[i]]->tick)
+      classes[classorder[i]]->tick(rq);
+  mcsrelease(&rq->lock);
+}
+
+// 프로세스가 종료하거나 클래스를 바꿀 때 클래스에 알린다. p->lock 을 잡고 호출해야 한다.
+// 클래스가 PUT_HOLD 로 붙잡고 있던 프로세스면 1 을 돌려준다.
+static int
+schedleave(struct proc *p)
+{
+  if(classes[p->class]->leave)
+    return classes[p->class]->leave(p);
+  return 0;
+}
+
+// 클래스가 PUT_HOLD 로 붙잡아 둔 프로세스 중 다시 실행할 때가 된 것을 실행 큐에 넣는다.
+// CPU 0 의 타이머 인터럽트에서 부른다. ready 가 돌려준 프로세스는 실행 큐에도
+// CPU 에도 없으므로 p->lock 은 돌려받은 뒤에 잡는다.
+static void
+schedready(void)
+{
+  struct proc *p;
+  int i;
+
+  for(i = 0; i < NSCHEDCLASS; i++){
+    if(classes[i]->ready == 0)
+      continue;
+    while((p = classes[i]->ready()) != 0){
+      mcsacquire(p->lock);
+      if(p->state == RUNNABLE && !p->onrq)
+        runqadd(p, 0);
+      mcsrelease(p->lock);
+    }
+  }
+}
+
+// 방금 CPU 를 내려놓은 프로세스를 클래스의 결정에 따라 실행 큐에 다시 넣거나,
+// CPU 사용 할당량을 다 썼으면 종료시킨다. p->lock 을 잡고 호출해야 한다.
+// PUT_HOLD 면 클래스가 붙잡아 두었다가 ready 로 돌려준다.
+// 종료는 kill 처럼 killed 를 켜서 사용자 모드로 돌아갈 때 exit() 하게 한다. 잠든 프로세스는
+// p->lock 보다 먼저 sleepq 의 lock 을 잡아야 깨울 수 있으므로 1 을 돌려주고,
+// 호출한 쪽이 p->lock 을 놓은 뒤 kill 로 깨운다.
+static int
+schedput(struct proc *p)
+{
+  int put;
+
+  if(p->state == ZOMBIE)
+    return 0;
+
+  put = classes[p->class]->put(p);
+
+// 프로세스가 할당량을 다 쓴 경우 종료
+  if(put == PUT_KILL){
+    p->killed = 1;
+    if(p->state == SLEEPING)
+      return 1;
+    put = PUT_FRONT;
+  }
+  if(p->state == RUNNABLE && put != PUT_HOLD)
+    runqadd(p, put == PUT_FRONT);
+  return 0;
+}
+
+// 새 프로세스가 parent 의 스케줄링 클래스를 물려받게 한다.
+// parent 가 0 (첫 프로세스) 이면 MLFQ 로 시작한다. 둘의 p->lock 을 잡고 호출해야 한다.
+// EDF 는 CPU 시간을 예약하는 클래스라 물려주지 않고, 자식은 MLFQ 로 시작한다.
+static void
+schedfork(struct proc *parent, struct proc *p)
+{
+  p->class = parent && parent->class != SCHED_EDF ? parent->class : SCHED_MLFQ;
+  classes[p->class]->fork(parent, p);
+}
 
 //PAGEBREAK: 42
 // Per-CPU process scheduler.
@@ -369,571 +1331,61 @@ int sig_level = 0;
 //  - swtch to start running that process
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
+// 프로세스 선택은 CPU 자신의 실행 큐 lock 만 잡고 하며,
+// 고른 프로세스의 p->lock 은 상태를 바꾸고 swtch 하는 동안만 잡는다.
 void
 scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int pid, killit;
   c->proc = 0;
   
   for(;;){
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-// 우선순위가 가장 높은 큐 (Q0) 탐색	
-    if((qP0 != -1 && sigQ == 0) || (qP0 != -1 && sigQ == 1 && sig_level == 0)) {
-	for(int i = qP0; i >= 0; i--) {
-	  p = Q0[i];
-	  
-	  if(p->state != RUNNABLE || p->q_level != 0)
-	    continue;
-	    
-	  c->proc = p;
-	 
-	  switchuvm(p);
-	  p->state = RUNNING;
-	  
-	  swtch(&(c->scheduler), p->context);
-	  switchkvm();
-
-	  if(p->io_wait_time >= 10) { // IO 프로세서
-	    p->state = SLEEPING;
-	    c->proc = 0;
-	    continue;
-	  }
-// Aging 체크: 대기 시간이 250 이상인 프로세스는 상위 큐로 이동
-	for(struct proc *pp = ptable.proc; pp < &ptable.proc[NPROC]; pp++) {
-	      if(pp->state != RUNNABLE || pp->q_level == 0 || pp->pid == 0 || pp->pid == 1 || pp->pid == 2)
-	        continue;
-	    
-	      if(pp->cpu_wait >= 250) {
-	        sigQ = 1;
-		sig_level = 0;
-	        if(pp->q_level == 1) {
-	          for(int i = 0; i <= qP1; i++) {
-	            if(Q1[i] == pp) {
-	            
-	              Q1[i] = NULL;
-	            
-	              for(int j = i; j < qP1; j++) {
-	                Q1[j] = Q1[j+1];
-	              }
-	              qP1--;
-	              qP0++;
-	            
-	              pp->q_level = 0;
-	              pp->cpu_wait = 0;
-	              #ifdef DEBUG 
-		      cprintf("PID: %d Aging\n", pp->pid);
-	              #endif 
-	              Q0[qP0] = pp;
-	              break;
-	            }
-	          }
-	        }
-	        else if(pp->q_level == 2) {
-	          for(int i = 0; i <= qP2; i++) {
-	            if(Q2[i] == pp) {
-	            
-	              Q2[i] = NULL;
-	            
-	              for(int j = i; j < qP2; j++) {
-	                Q2[j] = Q2[j+1];
-	              }
-	              qP2--;
-	              qP1++;
-	            
-	              pp->q_level = 1;
-	              pp->cpu_wait = 0;
-		      #ifdef DEBUG
-		      cprintf("PID: %d Aging\n", pp->pid);
-	              #endif 
-	              Q1[qP1] = pp;
-	              break;
-	            }
-	          }
-	        }
-	        else if(pp->q_level == 3) {
-	          for(int  i = 0; i <= qP3; i++) {
-	            if(Q3[i] == pp) {
-	            
-	              Q3[i] = NULL;
-	            
-	              for(int j = i; j < qP3; j++) {
-	                Q3[j] = Q3[j+1];
-	              } 
-	              qP3--;
-	              qP2++;
-	            
-	              pp->q_level = 2;
-	              pp->cpu_wait = 0;
-		      #ifdef DEBUG
-		      cprintf("PID: %d Aging\n", pp->pid);
-	              #endif
-	              Q2[qP2] = pp;
-	              break;
-	            }
-	          }
-	        } 
-	      }
-	    }
-// 프로세스가 할당된 시간만큼 CPU를 사용했거나 종료 조건에 도달했는지 확인
-	  if(p->cpu_burst - p->ticks >= time_quantum[0] || p->end_time - p->cpu_burst <= 0) {
-	    sigQ = 0; 
-	    int time_slice = p->cpu_burst - p->ticks;
-	    p->ticks = p->cpu_burst;
-	    
-	    Q0[i] = NULL; 
-	    for(int j = i; j < qP0; j++) {
-	      Q0[j] = Q0[j+1];
-	    }
-	    qP0--;
-	    
-	    if(p->end_time - p->cpu_burst > 0) {
-#ifdef DEBUG
-              cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-#endif
-            }
-// 프로세스가 종료된 경우
-            if(p->end_time - p->cpu_burst <= 0 && p->end_time != 0) {
-              if(p->end_time != 0 && p->pid != 0 && p->pid != 1 && p->pid != 2) {
-#ifdef DEBUG
-                cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-                cprintf("PID: %d, used %d ticks. terminated\n", p->pid, p->cpu_burst);
-#endif
-                p->state = ZOMBIE;
-
-                c->proc = 0;
-
-		wakeup1(p->parent);
-
-                break;
-              }
-            }
-// 다음 우선순위 큐로 프로세스 이동
-	    qP1++;
-	    p->q_level = 1;
-	    p->cpu_wait = 0;
-	    Q1[qP1] = p;
-
-	  }
-	
-	  c->proc = 0;
-	  break;
-	}
-    }
-    else if((qP1 != -1 && sigQ == 0) || (qP1 != -1 && sigQ == 1 && sig_level == 1)) {
-      for(int i = qP1; i >= 0; i--) {
-        p = Q1[i];
-        
-        if(p->state != RUNNABLE || p->q_level != 1)
-          continue;
-          
-        c->proc = p;
-        
-        switchuvm(p);
-        p->state = RUNNING;
-
-        swtch(&(c->scheduler), p->context);
-        switchkvm();
-
-	for(struct proc *pp = ptable.proc; pp < &ptable.proc[NPROC]; pp++) {
-	    if(pp->state != RUNNABLE || pp->q_level == 0 || pp->pid == 0 || pp->pid == 1 || pp->pid == 2)
-	      continue;
-	    
-	    if(pp->cpu_wait >= 250) {
-	      sigQ = 1;
-	      sig_level = 1;
-	      if(pp->q_level == 1) {
-	        for(int i = 0; i <= qP1; i++) {
-	          if(Q1[i] == pp) {
-	            
-	            Q1[i] = NULL;
-	            
-	            for(int j = i; j < qP1; j++) {
-	              Q1[j] = Q1[j+1];
-	            }
-	            qP1--;
-	            qP0++;
-		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif 
-	            pp->q_level = 0;
-	            pp->cpu_wait = 0;
-	            
-	            Q0[qP0] = pp;
-	            break;
-	          }
-	        }
-	      }
-	      else if(pp->q_level == 2) {
-	        for(int i = 0; i <= qP2; i++) {
-	          if(Q2[i] == pp) {
-	            
-	            Q2[i] = NULL;
-	            
-	            for(int j = i; j < qP2; j++) {
-	              Q2[j] = Q2[j+1];
-	            }
-	            qP2--;
-	            qP1++;
-		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif 
-	            pp->q_level = 1;
-	            pp->cpu_wait = 0;
-	            
-	            Q1[qP1] = pp;
-	            break;
-	          }
-	        }
-	      }
-	      else if(pp->q_level == 3) {
-	        for(int  i = 0; i <= qP3; i++) {
-	          if(Q3[i] == pp) {
-	            
-	            Q3[i] = NULL;
-	            
-	            for(int j = i; j < qP3; j++) {
-	              Q3[j] = Q3[j+1];
-	            } 
-	            qP3--;
-	            qP2++;
-		    #ifdef DEBUG 	
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif
-	            pp->q_level = 2;
-	            pp->cpu_wait = 0;
-	            
-	            Q2[qP2] = pp;
-	            break;
-	          }
-	        }
-	      }
-	    }
-	  }
-
-        
-        if(p->cpu_burst - p->ticks >= time_quantum[1] || p->end_time - p->cpu_burst <= 0) { 
-          sigQ = 0;
-
-	  int time_slice = p->cpu_burst - p->ticks;
-	  p->ticks = p->cpu_burst;
-          
-          Q1[i] = NULL;
-          
-          for(int j = i; j < qP1; j++) {
-            Q1[j] = Q1[j+1];
-          }
-          qP1--;
-
-	  if(p->end_time - p->cpu_burst > 0) {
-	#ifdef DEBUG
-            cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-#endif
-          }
-
-          if(p->end_time - p->cpu_burst <= 0 && p->end_time != 0) {
-            if(p->end_time != 0 && p->pid != 0 && p->pid != 1 && p->pid != 2) {
-#ifdef DEBUG
-              cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-              cprintf("PID: %d, used %d ticks. terminated\n", p->pid, p->cpu_burst);
-#endif
-              p->state = ZOMBIE;
-	      wakeup1(p->parent);
-
-              c->proc = 0;
-
-              break;
-            }
-          }
-			  
-	  qP2++;
-	  p->q_level = 2;
-	  p->cpu_wait = 0;
-	  Q2[qP2] = p;
-          
-        }
-        c->proc = 0;
-	break;
-      }
-    }
-    else if((qP2 != -1 && sigQ == 0) || (qP2 != -1 && sigQ == 1 && sig_level == 2)) {
-      for(int i = qP2; i >= 0; i--) {
-        p = Q2[i];
-      
-        if(p->state != RUNNABLE || p->q_level != 2)
-          continue;
-        
-        c->proc = p;
-      
-        switchuvm(p);
-        p->state = RUNNING;
-      
-        swtch(&(c->scheduler), p->context);
-        switchkvm();
-
-	for(struct proc *pp = ptable.proc; pp < &ptable.proc[NPROC]; pp++) {
-	    if(pp->state != RUNNABLE || pp->q_level == 0 || pp->pid == 0 || pp->pid == 1 || pp->pid == 2)
-	      continue;
-	    
-	    if(pp->cpu_wait >= 250) {
-	      sigQ = 1;
-	      sig_level = 2;
-	      if(pp->q_level == 1) {
-	        for(int i = 0; i <= qP1; i++) {
-	          if(Q1[i] == pp) {
-	            
-	            Q1[i] = NULL;
-	            
-	            for(int j = i; j < qP1; j++) {
-	              Q1[j] = Q1[j+1];
-	            }
-	            qP1--;
-	            qP0++;
-	            #ifdef DEBUG	
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif
-	            pp->q_level = 0;
-	            pp->cpu_wait -= 250;
-	            
-	            Q0[qP0] = pp;
-	            break;
-	          }
-	        }
-	      }
-	      else if(pp->q_level == 2) {
-	        for(int i = 0; i <= qP2; i++) {
-	          if(Q2[i] == pp) {
-	            
-	            Q2[i] = NULL;
-	            
-	            for(int j = i; j < qP2; j++) {
-	              Q2[j] = Q2[j+1];
-	            }
-	            qP2--;
-	            qP1++;
- 		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif 
-	            pp->q_level = 1;
-	            pp->cpu_wait -= 250;
-	            
-	            Q1[qP1] = pp;
-	            break;
-	          }
-	        }
-	      }
-	      else if(pp->q_level == 3) {
-	        for(int  i = 0; i <= qP3; i++) {
-	          if(Q3[i] == pp) {
-	            
-	            Q3[i] = NULL;
-	            
-	            for(int j = i; j < qP3; j++) {
-	              Q3[j] = Q3[j+1];
-	            } 
-	            qP3--;
-	            qP2++;
-		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif
-	            pp->q_level = 2;
-	            pp->cpu_wait -= 250;
-	            
-	            Q2[qP2] = pp;
-	            break;
-	          }
-	        }
-	      }
-	    }
-	  }
-		
-        if(p->cpu_burst - p->ticks >= time_quantum[2] || p->end_time - p->cpu_burst <= 0) {
-	  sigQ = 0;
-	  
-	  int time_slice = p->cpu_burst - p->ticks;
-	  p->ticks = p->cpu_burst;
-        
-          Q2[i] = NULL;
-        
-          for(int j = i; j < qP2; j++) {
-            Q2[j] = Q2[j+1];
-          }
-          qP2--;
-
-	  if(p->end_time - p->cpu_burst > 0) {
-#ifdef DEBUG
-            cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-#endif
-          }
-
-          if(p->end_time - p->cpu_burst <= 0 && p->end_time != 0) {
-            if(p->end_time != 0 && p->pid != 0 && p->pid != 1 && p->pid != 2) {
-#ifdef DEBUG
-              cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-              cprintf("PID: %d, used %d ticks. terminated\n", p->pid, p->cpu_burst);
-#endif
-              p->state = ZOMBIE;
-	      wakeup1(p->parent);
-
-              c->proc = 0;
-              
-	      break;
-            }
-          }
-
-	  qP3++;
-	  p->q_level = 3;
-	  p->cpu_wait = 0;
-	  Q3[qP3] = p;
-
-	}
-	c->proc = 0;
-	break;
-      }
+    // 자신의 큐에서 먼저 꺼내고, 비어 있으면 다른 CPU 에서 훔쳐온다.
+    // 훔쳐올 것도 없으면 깨워줄 때까지 쉰다.
+    if((p = runqpop(c->rq)) == 0 && (p = runqsteal(c)) == 0){
+      cpuidle(c);
+      continue;
     }
-    else if((qP3 != -1 && sigQ == 0) || (qP3 != -1 && sigQ == 1 && sig_level == 3)) {
-      for(int i = qP3; i >= 0; i--) {
-        p = Q3[i];
-
-	if(p->state != RUNNABLE || p->q_level != 3)
-          continue;
-
-	c->proc = p;
-
-        switchuvm(p);
-        p->state = RUNNING;
-        
-        swtch(&(c->scheduler), p->context);
-        switchkvm();
-
-	for(struct proc *pp = ptable.proc; pp < &ptable.proc[NPROC]; pp++) {
-	    if(pp->state != RUNNABLE || pp->q_level == 0 || pp->pid == 0 || pp->pid == 1 || pp->pid == 2)
-	      continue;
-	    
-	    if(pp->cpu_wait >= 250) {
-	      sigQ = 1;
-	      sig_level = 3;
-	      if(pp->q_level == 1) {
-	        for(int i = 0; i <= qP1; i++) {
-	          if(Q1[i] == pp) {
-	            
-	            Q1[i] = NULL;
-	            
-	            for(int j = i; j < qP1; j++) {
-	              Q1[j] = Q1[j+1];
-	            }
-	            qP1--;
-	            qP0++;
-		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif
-	            pp->q_level = 0;
-	            pp->cpu_wait -= 250;
-	            
-	            Q0[qP0] = pp;
-	            break;
-	          }
-	        }
-	      }
-	      else if(pp->q_level == 2) {
-	        for(int i = 0; i <= qP2; i++) {
-	          if(Q2[i] == pp) {
-	            
-	            Q2[i] = NULL;
-	            
-	            for(int j = i; j < qP2; j++) {
-	              Q2[j] = Q2[j+1];
-	            }
-	            qP2--;
-	            qP1++;
-		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-	            #endif 
-	            pp->q_level = 1;
-	            pp->cpu_wait -= 250;
-	            
-	            Q1[qP1] = pp;
-	            break;
-	          }
-	        }
-	      }
-	      else if(pp->q_level == 3) {
-	        for(int  i = 0; i <= qP3; i++) {
-	          if(Q3[i] == pp) {
-	            
-	            Q3[i] = NULL;
-	            
-	            for(int j = i; j < qP3; j++) {
-	              Q3[j] = Q3[j+1];
-	            } 
-	            qP3--;
-	            qP2++;
-   		    #ifdef DEBUG
-		    cprintf("PID: %d Aging\n", pp->pid);
-		    #endif	            
-	            pp->q_level = 2;
-	            pp->cpu_wait -= 250;
-	            
-	            Q2[qP2] = pp;
-	            break;
-	          }
-	        }
-	      }
-
-	    }
-	  }
-
-	if(p->cpu_burst - p->ticks >= time_quantum[3] || p->end_time - p->cpu_burst <= 0) { 
-	  sigQ = 0;
-	  
-	  int time_slice = p->cpu_burst - p->ticks;
-	  p->ticks = p->cpu_burst;
-
-	  Q3[i] = NULL;
-	  
-	  for(int j = i; j < qP3; j++) {
-	    Q3[j] = Q3[j+1];
-	  }
-	 
-	  if(p->end_time - p->cpu_burst > 0) {
-#ifdef DEBUG
-	    cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);	
-#endif 
-	  }
-	  
-	  if(p->end_time - p->cpu_burst <= 0 && p->end_time != 0) {
-	    if(p->end_time != 0 && p->pid != 0 && p->pid != 1 && p->pid != 2) {
-#ifdef DEBUG
-	      cprintf("PID: %d uses %d ticks in mlfq[%d], total(%d/%d)\n", p->pid, time_slice, p->q_level, p->cpu_burst, p->end_time);
-	      cprintf("PID: %d, used %d ticks. terminated\n", p->pid, p->cpu_burst);
-#endif
-	      qP3--; 
-	      c->proc = 0;
-	      
-	      p->state = ZOMBIE;
-	      wakeup1(p->parent);
-
-	      break;
-	    }
-	  }
-	  
-	  p->q_level = 3;
-	  p->cpu_wait = 0;
-	  Q3[qP3] = p;
-	}
-	c->proc = 0;
-        break;	
-      }
+
+    mcsacquire(p->lock);
+    if(p->state != RUNNABLE){
+      mcsrelease(p->lock);
+      continue;
     }
-    release(&ptable.lock);
+
+    // Switch to chosen process.  It is the process's job
+    // to release p->lock and then reacquire it
+    // before jumping back to us.
+    p->cpu = c - cpus;
+    c->proc = p;
+    switchuvm(p);
+    cycacct(p, RUNNABLE);
+    p->state = RUNNING;
+    p->nswtch++;
+    schedtrace(SCHED_DISPATCH, p, 0);
+
+    swtch(&(c->scheduler), p->context);
+    switchkvm();
+
+    // Process is done running for now.
+    c->proc = 0;
+    killit = schedput(p);
+    pid = p->pid;
+    mcsrelease(p->lock);
+    if(killit)
+      kill(pid);
+
+    // 클래스별 tick 작업: MLFQ 는 대기 시간이 schedconf.aging 이상인 프로세스를 상위 큐로 이동
+    runqtick(c->rq);
   }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only p->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
@@ -946,14 +1398,16 @@ sched(void)
   int intena;
   struct proc *p = myproc(); // 현재 실행 중인 프로세스를 proc 구조체에 대입
 
-  if(!holding(&ptable.lock)) // 테이블 락이 없으면 panic 함수 호출
-    panic("sched ptable.lock");
+  if(!mcsholding(p->lock)) // 프로세스 락이 없으면 panic 함수 호출
+    panic("sched p->lock");
   if(mycpu()->ncli != 1) // 현재 CPU 의 모든 잠금이 해제되지 않은 경우 panic 함수 호출
     panic("sched locks");
   if(p->state == RUNNING) // 프로세스 상태가 실행 중인 경우 panic 함수 호출
     panic("sched running");
   if(readeflags()&FL_IF) // 인터럽트가 비활성화 되어 있지 않은 경우 panic 함수 호출
     panic("sched interruptible");
+  cycacct(p, RUNNING); // 이번에 CPU 를 쓴 시간을 청구
+  p->lastrun = p->stamp;
   intena = mycpu()->intena; // 현재 CPU 의 인터럽트를 저장
   swtch(&p->context, mycpu()->scheduler); // 현재 프로세스의 문맥을 현재 CPU 스케줄러와 바꿈
   mycpu()->intena = intena; // 이전 인터럽트 플래그를 복원
@@ -963,11 +1417,13 @@ sched(void)
 void
 yield(void) // 현재 CPU 에서 실행 중인 프로세스를 중단하고 다른 프로세스가 실행되도록 하는 함수
 {
-  // 프로세스 테이블에 접근하기 위해 락 획득
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE; // 상태를 실행가능 상태로 설정
+  struct proc *p = myproc();
+
+  // 프로세스 상태를 바꾸기 위해 락 획득
+  mcsacquire(p->lock);  //DOC: yieldlock
+  p->state = RUNNABLE; // 상태를 실행가능 상태로 설정
   sched(); // 스케줄러를 호출하여 CPU 을 다른 프로세스로 양보
-  release(&ptable.lock); // 테이블 락 해제
+  mcsrelease(p->lock); // 프로세스 락 해제
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -976,8 +1432,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding p->lock from scheduler.
+  mcsrelease(myproc()->lock);
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -991,69 +1447,132 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
-// Atomically release lock and sleep on chan.
-// Reacquires lock when awakened.
-void  
-sleep(void *chan, struct spinlock *lk)
+// 잠드는 프로세스를 버킷 sq 에 넣는다. sq->lock 을 잡고 호출해야 한다.
+static void
+sleepqadd(struct sleepq *sq, struct proc *p)
+{
+  p->sprev = 0;
+  p->snext = sq->head;
+  if(sq->head)
+    sq->head->sprev = p;
+  sq->head = p;
+}
+
+// 프로세스를 버킷 sq 에서 뺀다. 버킷에 없으면 아무것도 하지 않는다.
+// sq->lock 을 잡고 호출해야 한다.
+static void
+sleepqremove(struct sleepq *sq, struct proc *p)
+{
+  if(p->sprev)
+    p->sprev->snext = p->snext;
+  else if(sq->head == p)
+    sq->head = p->snext;
+  else
+    return;
+  if(p->snext)
+    p->snext->sprev = p->sprev;
+  p->snext = p->sprev = 0;
+}
+
+// 잠든 프로세스를 버킷에서 빼고 실행 큐에 넣는다. sq->lock 과 p->lock 을 잡고 호출해야 한다.
+static void
+sleepqwake(struct sleepq *sq, struct proc *p)
+{
+  sleepqremove(sq, p);
+  cycacct(p, SLEEPING);
+  p->io_wait_time += ticks - p->slptick;
+  p->state = RUNNABLE;
+  if(classes[p->class]->wake)
+    classes[p->class]->wake(p);
+  runqadd(p, 0); // 마지막으로 실행된 CPU 의 실행 큐에 넣는다
+}
+
+// sleep 의 앞 절반. chan 의 버킷에 들어가 SLEEPING 이 되고 p->lock 을 잡은 채로 돌아온다.
+// 호출한 쪽은 조건을 보호하던 lock 을 놓고 sleepdone 을 부른다.
+// 깨우는 쪽은 조건을 바꾼 뒤 버킷을 보므로, 그 lock 을 놓은 뒤에 온 wakeup 은
+// 이 프로세스를 찾아 p->lock 을 기다렸다가 깨운다. 그래서 wakeup 을 잃지 않는다.
+static void
+sleepprep(void *chan)
 {
   struct proc *p = myproc(); // 현재 프로세스를 proc 구조체에 대입
-  
+  struct sleepq *sq = &sleepq[SLEEPHASH(chan)];
+
   if(p == 0) // 프로세스의 값이 0, 실행 중인 프로세스가 없다면 panic() 함수 호출
     panic("sleep");
 
-  if(lk == 0) // 테이블 락이 없으면 panic() 함수 호출
-    panic("sleep without lk");
-
-  // Must acquire ptable.lock in order to
-  // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
-  // 테이블 락이 아닌 경우
-  // 테이블 락을 획득하고 원래 가지고 있던 락을 해제
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC제: sleeplock1
-    release(lk);
-  }
+  mcsacquire(&sq->lock);
+  mcsacquire(p->lock);  //DOC: sleeplock1
   // Go to sleep.
   p->chan = chan; // 채널 설정
   p->state = SLEEPING; // 설정한 채널의 상태를 SLEEPING 으로 설정
+  p->slptick = ticks;
+  sleepqadd(sq, p); // chan 의 버킷에 넣어 wakeup 이 이 버킷만 보게 한다
+  mcsrelease(&sq->lock);
+}
+
+// sleep 의 뒤 절반. 깨워질 때까지 CPU 를 내려놓고, 깨워지면 p->lock 을 놓는다.
+static void
+sleepdone(void)
+{
+  struct proc *p = myproc();
 
   sched(); // 스케줄러 호출하여 현재 실행 중인 프로세스 중단하고 다른 프로세스 실행
 
   // Tidy up.
   p->chan = 0; // 채널을 0으로 초기화
+  mcsrelease(p->lock);  //DOC: sleeplock2
+}
+
+// Atomically release lock and sleep on chan.
+// Reacquires lock when awakened.
+void  
+sleep(void *chan, struct spinlock *lk)
+{
+  if(lk == 0) // 락이 없으면 panic() 함수 호출
+    panic("sleep without lk");
+
+  sleepprep(chan);
+  release(lk);
+  sleepdone();
 
   // Reacquire original lock.
-  // 테이블 락이 아닌 경우
-  // 해제하고 원래 락 가져온다
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  acquire(lk);
 }
 
-//PAGEBREAK!
-// Wake up all processes sleeping on chan.
-// The ptable lock must be held.
-static void
-wakeup1(void *chan) // SLEEPING 상태의 프로세스를 깨워 실행가능한 상태로 전환하는 함수
+// sleep 과 같지만 조건을 MCS lock 으로 보호하는 경우 (tickslock).
+void
+mcssleep(void *chan, struct mcslock *lk)
 {
-  struct proc *p; // 프로세스 구조체 선언
+  if(lk == 0)
+    panic("sleep without lk");
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) // 테이블을 반복문을 통해 탐색하면서 SLEEPING 상태의 프로세스를 찾는다
-    if(p->state == SLEEPING && p->chan == chan) // 상태가 SLEEPING 이고 채널이 같으면 프로세스의 상태를 실행가능한 상태로 전환
-      p->state = RUNNABLE;
+  sleepprep(chan);
+  mcsrelease(lk);
+  sleepdone();
+  mcsacquire(lk);
 }
 
+//PAGEBREAK!
 // Wake up all processes sleeping on chan.
+// 전체 프로세스 테이블 대신 chan 의 버킷에 있는 프로세스만 확인한다.
+// 버킷에 있는 프로세스의 chan 은 버킷의 lock 이 보호하므로 p->lock 은 깨울 프로세스만 잡는다.
 void 
 wakeup(void *chan) // chan 에 맞는 프로세스 중 SLEEPING 상태의 프로세스를 모두 깨우는 함수
 {
-  acquire(&ptable.lock); // 테이블 락 획득
-  wakeup1(chan); // wakeup1 함수를 이용하여 채널에 맞는 프로세스를 깨운다
-  release(&ptable.lock); // 락 해
+  struct sleepq *sq = &sleepq[SLEEPHASH(chan)];
+  struct proc *p, *next; // 프로세스 구조체 선언
+
+  mcsacquire(&sq->lock); // 버킷 락 획득
+  for(p = sq->head; p; p = next){ // 버킷을 따라가며 SLEEPING 상태의 프로세스를 찾는다
+    next = p->snext;
+    if(p->chan != chan)
+      continue;
+    mcsacquire(p->lock); // 아직 sched() 에서 넘어가는 중이면 끝날 때까지 기다린다
+    if(p->state == SLEEPING && p->chan == chan) // 상태가 SLEEPING 이고 채널이 같으면 프로세스의 상태를 실행가능한 상태로 전환
+      sleepqwake(sq, p);
+    mcsrelease(p->lock);
+  }
+  mcsrelease(&sq->lock); // 락 해제
 }
 
 // Kill the process with the given pid.
@@ -1063,20 +1582,265 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct sleepq *sq;
 
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
+  mcsacquire(&pidlock); // 슬롯이 다른 프로세스에게 가지 않게 잡아 둔다
+  if((p = pidlookup(pid)) == 0){
+    mcsrelease(&pidlock);
+    return -1;
+  }
+  mcsacquire(p->lock);
+  p->killed = 1;
+  // Wake process from sleep if necessary.
+  // 버킷의 lock 을 먼저 잡아야 하므로 p->lock 을 놓았다가 다시 잡는다.
+  // 그 사이에 깨어났으면 killed 를 보고 스스로 끝낸다.
+  if(p->state == SLEEPING){
+    sq = &sleepq[SLEEPHASH(p->chan)];
+    mcsrelease(p->lock);
+    mcsacquire(&sq->lock);
+    mcsacquire(p->lock);
+    if(p->state == SLEEPING && sq == &sleepq[SLEEPHASH(p->chan)])
+      sleepqwake(sq, p);
+    mcsrelease(&sq->lock);
+  }
+  mcsrelease(p->lock);
+  mcsrelease(&pidlock);
+  return 0;
+}
+
+// 사용 중인 프로세스 정보를 최대 n 개까지 pi 에 채우고 채운 개수를 돌려준다.
+// ptable 을 한 번만 훑고, 프로세스마다 그 p->lock 만 잡는다. pi 는 사용자 메모리라서
+// 쓰다가 폴트가 날 수 있으므로 lock 을 잡은 동안에는 info 에 모으고 놓은 뒤에 복사한다.
+// 그 사이에 다른 스레드가 pi 를 없앴으면 -1.
+int
+getprocinfo(struct procinfo *pi, int n)
+{
+  struct proc *p;
+  struct procinfo info;
+  int cnt = 0;
+
+  memset(&info, 0, sizeof(info));
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && cnt < n; p++){
+    mcsacquire(p->lock);
+    if(p->state == UNUSED){
+      mcsrelease(p->lock);
+      continue;
     }
+    info.pid = p->pid;
+    info.state = p->state;
+    info.q_level = p->q_level;
+    info.cpu_burst = p->cpu_burst;
+    // MLFQ 큐에서 기다리는 중이면 이번에 기다린 시간까지 더해서 보여준다
+    info.cpu_wait = p->class == SCHED_MLFQ && p->state == RUNNABLE && p->onrq ?
+      p->cpu_wait + ticks - p->qtick : p->cpu_wait;
+    // 잠들어 있으면 이번에 잠든 시간까지 더해서 보여준다
+    info.io_wait_time = p->state == SLEEPING ? p->io_wait_time + ticks - p->slptick : p->io_wait_time;
+    info.end_time = p->end_time;
+    info.cpu = p->cpu;
+    info.nswtch = p->nswtch;
+    info.class = p->class;
+    info.tickets = p->tickets;
+    info.nice = p->nice;
+    info.edfmiss = p->edfmiss;
+    info.interact = mlfq_interact(p->ivrun, p->ivslp);
+    info.nmigrate = p->nmigrate;
+    info.runcyc = p->runcyc;
+    info.waitcyc = p->waitcyc;
+    info.sleepcyc = p->sleepcyc;
+    safestrcpy(info.name, p->name, sizeof(info.name));
+    mcsrelease(p->lock);
+    if(copyuser(pi++, &info, sizeof(info)) < 0)
+      return -1;
+    cnt++;
   }
-  release(&ptable.lock);
-  return -1;
+  return cnt;
+}
+
+// 실행 큐에서 기다리는 p 의 큐 lock 을 잡고 그 큐를 돌려준다. 큐에 없으면 0.
+// p->lock 을 잡고 호출한다. lock 을 기다리는 사이에 부하 분산이 다른 큐로 옮기거나
+// 다른 CPU 가 꺼내 갈 수 있으므로, 잡은 뒤에 다시 확인한다.
+static struct runq*
+runqlock(struct proc *p)
+{
+  struct runq *rq;
+
+  while(p->onrq){
+    rq = &runqs[p->cpu];
+    mcsacquire(&rq->lock);
+    if(p->onrq && rq == &runqs[p->cpu])
+      return rq;
+    mcsrelease(&rq->lock);
+  }
+  return 0;
+}
+
+// pid 프로세스 (0 이면 자신)의 스케줄링 클래스를 attr 로 바꾼다.
+// 실행 큐에서 기다리는 중이면 빼서 새 클래스의 큐에 다시 넣고, 실행 중이면
+// CPU 를 내려놓을 때 새 클래스가 받는다. 잘못된 인자거나 프로세스가 없으면 -1.
+// EDF 는 예약한 CPU 시간의 합이 schedconf.edfutil 을 넘어도 -1.
+int
+sched_setattr(int pid, struct schedattr *attr)
+{
+  struct proc *p;
+  struct runq *rq;
+  int queued = 0, ret = 0;
+
+  if(attr->class < 0 || attr->class >= NSCHEDCLASS)
+    return -1;
+
+  if((p = proclock(pid)) == 0)
+    return -1;
+  if(p->state == EMBRYO || p->state == ZOMBIE){
+    mcsrelease(p->lock);
+    return -1;
+  }
+  if((rq = runqlock(p)) != 0){
+    classes[p->class]->dequeue(rq, p);
+    runqtake(rq, p);
+    mcsrelease(&rq->lock);
+    queued = 1;
+  }
+  // 클래스별 인자를 검사하고 넣는다 (EDF 는 여기서 admission control 을 한다)
+  if(classes[attr->class]->setattr && classes[attr->class]->setattr(p, attr) < 0)
+    ret = -1;
+  else if(p->class != attr->class){
+    if(schedleave(p) && p->state == RUNNABLE)
+      queued = 1;
+    p->class = attr->class;
+    classes[p->class]->fork(0, p);
+  }
+  if(queued)
+    runqadd(p, 0);
+  mcsrelease(p->lock);
+  return ret;
+}
+
+// 자신의 MLFQ 단계와 CPU 사용 기록을 바꾼다 (set_proc_info 시스템 호출).
+// 스케줄러가 같은 필드를 고치므로 p->lock 을 잡고, sched_setattr 처럼 실행 큐에서
+// 기다리는 중이면 빼서 새 단계의 큐에 다시 넣는다. 실행 중이면 CPU 를 내려놓을 때
+// 새 q_level 의 큐로 들어간다. time quantum 은 지금부터 다시 세고,
+// 이미 기다린 시간(cpu_wait)은 그 큐에서 기다리는 시간에 더해 Aging 한다.
+void
+set_proc_info(int q_level, int cpu_burst, int cpu_wait, int io_wait_time, int end_time)
+{
+  struct proc *p;
+  struct runq *rq;
+  int queued = 0;
+
+  p = proclock(0);
+  if((rq = runqlock(p)) != 0){
+    classes[p->class]->dequeue(rq, p);
+    runqtake(rq, p);
+    mcsrelease(&rq->lock);
+    queued = 1;
+  }
+  p->q_level = q_level;
+  p->cpu_burst = cpu_burst;
+  p->cpu_wait = cpu_wait;
+  p->io_wait_time = io_wait_time;
+  p->end_time = end_time;
+  p->ticks = p->cpu_burst;
+  p->runrem = 0;
+  if(queued)
+    runqadd(p, 0);
+  mcsrelease(p->lock);
+}
+
+// pid 프로세스 (0 이면 자신)의 스케줄링 클래스를 attr (사용자 메모리) 에 채운다.
+int
+sched_getattr(int pid, struct schedattr *attr)
+{
+  struct proc *p;
+  struct schedattr a;
+
+  if((p = proclock(pid)) == 0)
+    return -1;
+  a.class = p->class;
+  a.tickets = p->tickets;
+  a.nice = p->nice;
+  a.runtime = p->edfruntime;
+  a.deadline = p->edfdeadline;
+  a.period = p->edfperiod;
+  mcsrelease(p->lock);
+  return copyuser(attr, &a, sizeof(a));  // 사용자 메모리이므로 lock 을 놓은 뒤에 쓴다
+}
+
+// pid 프로세스 (0 이면 자신)가 실행될 수 있는 CPU 를 mask 로 정한다 (bit n = CPU n).
+// 없는 CPU 의 비트는 무시하고, 남는 CPU 가 없거나 프로세스가 없으면 -1.
+// 실행 큐에서 기다리는 중인데 그 큐의 CPU 에서 실행될 수 없게 되면 다른 큐로 옮기고,
+// 실행 중이면 CPU 를 내려놓을 때 옮긴다.
+int
+sched_setaffinity(int pid, uint mask)
+{
+  struct proc *p;
+  struct runq *rq;
+
+  mask &= (1 << ncpu) - 1;
+  if(mask == 0)
+    return -1;
+
+  if((p = proclock(pid)) == 0)
+    return -1;
+  if(p->state == EMBRYO || p->state == ZOMBIE){
+    mcsrelease(p->lock);
+    return -1;
+  }
+  // 부하 분산이 옛 mask 를 보고 옮겼을 수 있으므로 큐의 lock 을 잡은 뒤에 확인한다
+  p->affinity = mask;
+  if((rq = runqlock(p)) != 0){
+    if(CANRUN(p, p->cpu)){
+      mcsrelease(&rq->lock);
+    } else {
+      classes[p->class]->dequeue(rq, p);
+      runqtake(rq, p);
+      mcsrelease(&rq->lock);
+      runqadd(p, 0);
+    }
+  }
+  mcsrelease(p->lock);
+  return 0;
+}
+
+// pid 프로세스 (0 이면 자신)가 실행될 수 있는 CPU 를 mask 에 채운다.
+int
+sched_getaffinity(int pid, uint *mask)
+{
+  struct proc *p;
+  uint m;
+
+  if((p = proclock(pid)) == 0)
+    return -1;
+  m = p->affinity & ((1 << ncpu) - 1);
+  mcsrelease(p->lock);
+  return copyuser(mask, &m, sizeof(m));  // 사용자 메모리이므로 lock 을 놓은 뒤에 쓴다
+}
+
+// CPU 마다 idle 시간 통계를 최대 n 개까지 cs 에 채우고 채운 개수를 돌려준다.
+// 통계는 각 CPU 가 자기 것만 쓰므로 lock 없이 읽는다.
+int
+getcpustat(struct cpustat *cs, int n)
+{
+  struct cpu *c;
+  struct cpustat st;
+  int i;
+
+  for(i = 0; i < n && i < ncpu; i++){
+    c = &cpus[i];
+    st.cpu = i;
+    st.apicid = c->apicid;
+    st.ticks = c->nticks;
+    st.idleticks = c->idleticks;
+    st.idlecycles = c->idlecycles;
+    st.nrun = c->rq->nrun;
+    st.cycpertick = cycpertick;
+    st.load = c->rq->load;
+    st.nmigin = c->nmigin;
+    st.nmigout = c->nmigout;
+    if(copyuser(&cs[i], &st, sizeof(st)) < 0)
+      return -1;
+  }
+  return i;
 }
 
 //PAGEBREAK: 36
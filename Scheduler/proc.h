@@ -8,22 +8,49 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  struct runq *rq;             // 이 CPU 가 소유한 MLFQ 실행 큐 (proc.c)
+  volatile uint idle;          // 할 일이 없어 hlt 로 쉬고 있으면 1 (깨우는 쪽이 0 으로 바꾼다)
+  uint nticks;                 // 이 CPU 가 받은 타이머 인터럽트 수
+  uint idleticks;              // 그 중 쉬고 있을 때 받은 수
+  uint64 idlecycles;           // hlt 로 쉰 시간 (TSC cycle)
+  uint nmigin;                 // 다른 CPU 의 실행 큐에서 이 CPU 로 옮겨온 프로세스 수
+  uint nmigout;                // 이 CPU 의 실행 큐에서 다른 CPU 로 옮겨간 프로세스 수
+  volatile uint tlbreq;        // 다른 CPU 가 TLB 를 비우라고 요청한 횟수 (tlbshootdown)
+  volatile uint tlbdone;       // 그 중 이 CPU 가 비운 것까지의 tlbreq 값
 };
 
 extern struct cpu cpus[NCPU];
 extern int ncpu;
 // proc.h
-extern void set_proc_info(int *q_level, int *cpu_burst, int *cpu_wait, int *io_wait_time, int *end_time);
-extern struct proc* Q0[64];
-extern struct proc* Q1[64];
-extern struct proc* Q2[64];
-extern struct proc* Q3[64];
-extern int qP0;
-extern int qP1;
-extern int qP2;
-extern int qP3;
-extern int sigQ;
-extern int sig_level;
+struct schedconfig;
+struct procinfo;
+struct cpustat;
+struct schedattr;
+struct spawnfa;
+struct spawnattr;
+
+extern void set_proc_info(int q_level, int cpu_burst, int cpu_wait, int io_wait_time, int end_time);
+extern int sched_setconfig(struct schedconfig *sc);
+extern void sched_getconfig(struct schedconfig *sc);
+extern void schedtraceinit(void);
+extern void schedtrace(int type, struct proc *p, int slice);
+extern int getprocinfo(struct procinfo *pi, int n);
+extern void schedtick(void);
+extern int getcpustat(struct cpustat *cs, int n);
+extern void mlfqinit(void);
+extern void edfinit(void);
+extern int sched_setattr(int pid, struct schedattr *attr);
+extern int sched_getattr(int pid, struct schedattr *attr);
+extern int sched_setaffinity(int pid, uint mask);
+extern int sched_getaffinity(int pid, uint *mask);
+extern int clone(void (*fcn)(void*, void*), void *arg1, void *arg2, void *stack);
+extern int join(void **stack);
+extern int pagefault(uint va, uint err);
+extern int pagein(uint va, uint n, int write);
+extern void tlbshootdown(pde_t *pgdir);
+extern void tlbintr(void);
+extern int vmsharing(void);
+extern int spawn(char *path, char **argv, struct spawnfa *fa, struct spawnattr *attr);
 
 //PAGEBREAK: 17
 // Saved registers for kernel context switches.
@@ -48,6 +75,7 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
 struct proc {
+  struct mcslock *lock;        // state, chan, killed 와 스케줄링 필드를 보호 (proc.c 의 ptable.plock)
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
@@ -65,8 +93,56 @@ struct proc {
   int cpu_burst; // 프로세스당 time quantum 내에서 cpu 사용시간을 나타내는 변수 
   int cpu_wait; // 프로세스 당 RUNNABLE 상태에서 큐에서 대기하는 시간을 나타내는 변수
   int io_wait_time; // 프로세스 당 해당 큐에서 SLEEPING 상태 시간을 나타내는 변수
+  uint slptick; // 이번에 잠들기 시작한 tick (깨어날 때 io_wait_time 에 더한다)
   int end_time; // 응용 프로그램의 총 CPU 사용 할당량을 나타내는 변수
-  int ticks;
+  int ticks; // 현재 time quantum 이 시작될 때의 cpu_burst 값
+  int cpu; // 프로세스가 들어가는 실행 큐의 CPU 번호 (마지막으로 실행된 CPU)
+  uint qtick; // 실행 큐에서 이번에 기다리기 시작한 tick (cpu_wait 와 함께 Aging 기준)
+  struct proc *qnext; // 실행 큐 연결 리스트의 다음 프로세스 (UNUSED 면 free list)
+  struct proc *qprev; // 실행 큐 연결 리스트의 이전 프로세스
+  int nswtch; // CPU 에 올라간 횟수 (문맥 교환 횟수)
+  struct proc *snext; // 같은 wait channel 버킷에서 잠든 다음 프로세스
+  struct proc *sprev; // 같은 wait channel 버킷에서 잠든 이전 프로세스
+  struct proc *pidnext; // 같은 pid 해시 버킷의 다음 프로세스
+  struct proc *children; // 자식 프로세스 목록의 첫 번째 (p->sibling 으로 연결)
+  struct proc *sibling; // 부모의 자식 목록에서 다음 형제 프로세스
+  uint64 stamp; // 마지막으로 상태가 바뀐 (또는 사용 시간을 청구한) 때의 TSC
+  uint64 runcyc; // RUNNING 으로 보낸 전체 시간 (TSC cycle)
+  uint64 waitcyc; // RUNNABLE 로 실행 큐에서 기다린 전체 시간
+  uint64 sleepcyc; // SLEEPING 으로 보낸 전체 시간
+  uint64 runrem; // 아직 cpu_burst 에 1 tick 으로 더하지 못한 실행 시간
+  int class; // 스케줄링 클래스 (SCHED_*, schedclass.h)
+  int onrq; // 실행 큐에 들어 있으면 1 (CPU 가 꺼내 간 뒤 아직 RUNNING 이 아니면 0)
+  int tickets; // stride 클래스의 tickets
+  uint pass; // stride 클래스의 pass (stridecpu 실행 큐의 pass 기준)
+  int stridecpu; // pass 의 기준이 되는 실행 큐의 CPU 번호 (-1 이면 큐의 pass 에 대한 상대값)
+  int nice; // CFS 클래스의 nice (CFS_MINNICE ~ CFS_MAXNICE)
+  uint64 vruntime; // CFS 클래스의 가상 실행 시간 (cfscpu 실행 큐의 minvr 기준)
+  int cfscpu; // vruntime 의 기준이 되는 실행 큐의 CPU 번호 (-1 이면 minvr 에 대한 상대값)
+  int cfsslice; // CFS 클래스에서 이번에 CPU 에 올라가 실행할 tick 수
+  uint64 cfsstart; // 마지막으로 vruntime 을 더했을 때의 runcyc
+  struct proc *rbparent; // CFS red-black tree 의 부모
+  struct proc *rbleft; // CFS red-black tree 의 왼쪽 자식
+  struct proc *rbright; // CFS red-black tree 의 오른쪽 자식
+  int rbred; // red-black tree 에서 빨간 노드면 1
+  int edfruntime; // EDF 클래스의 주기마다 쓸 CPU 시간 (tick)
+  int edfdeadline; // EDF 클래스의 상대 deadline (tick)
+  int edfperiod; // EDF 클래스의 주기 (tick)
+  int edfleft; // 이번 주기에 남은 runtime
+  uint edfdl; // 이번 주기의 deadline (ticks 값)
+  uint edfnext; // 다음 주기가 시작되는 ticks 값
+  int edfmiss; // deadline 을 넘겨 끝난 횟수
+  uint edfmissdl; // 마지막으로 놓친 것으로 센 주기의 deadline (한 주기에 한 번만 센다)
+  int edfheld; // runtime 을 다 써서 다음 주기까지 실행 큐 밖에서 기다리면 1
+  uint64 ivrun; // 최근에 실행한 시간 (TSC cycle, 상호작용 점수용으로 점점 줄어든다)
+  uint64 ivslp; // 최근에 스스로 잠든 시간
+  uint affinity; // 실행될 수 있는 CPU 의 비트 (bit n = CPU n)
+  uint load; // 실행 큐에 들어 있는 동안 큐의 부하에 더한 가중치 (runqput)
+  uint64 lastrun; // 마지막으로 CPU 를 내려놓은 때의 TSC
+  int nmigrate; // 다른 CPU 의 실행 큐로 옮겨간 횟수
+  int thread; // clone 으로 만든 스레드면 1 (부모와 pgdir 을 함께 쓴다)
+  uint ustack; // clone 에 넘긴 사용자 스택 페이지의 주소 (join 이 돌려준다)
+  uint onfault; // copyuser 가 복사하는 동안 폴트를 처리하지 못하면 돌아갈 eip (trap.c)
 };
 
 // Process memory is laid out contiguously, low addresses first:
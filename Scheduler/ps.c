@@ -0,0 +1,67 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+#define NPI 64 // 한 번에 받는 프로세스 정보 수 (NPROC)
+#define NCS 8  // 한 번에 받는 CPU 정보 수 (NCPU)
+
+static char *states[] = {
+  "unused", "embryo", "sleep", "runble", "run", "zombie"
+};
+
+static char *classes[NSCHEDCLASS] = { "mlfq", "stride", "cfs", "edf" };
+
+// getprocinfo 로 모든 프로세스의 스케줄러 정보를 한 번에 받아 출력하는 프로그램.
+// getcpustat 으로 받은 CPU 별 idle 시간도 함께 출력한다.
+//   ps              한 번 출력
+//   ps <interval>   interval tick 마다 다시 출력 (top 처럼)
+int main(int argc, char **argv) {
+  static struct procinfo pi[NPI];
+  static struct cpustat cs[NCS];
+  int i, n, ncs, interval;
+
+  interval = argc > 1 ? atoi(argv[1]) : 0;
+
+  for(;;) {
+    if((n = getprocinfo(pi, NPI)) < 0) {
+      printf(2, "getprocinfo error\n");
+      exit();
+    }
+
+    if((ncs = getcpustat(cs, NCS)) < 0) {
+      printf(2, "getcpustat error\n");
+      exit();
+    }
+
+    printf(1, "tick %d\n", uptime());
+    // IDLE% 는 쉬고 있을 때 받은 타이머 인터럽트의 비율, MCYC 는 쉰 시간 (2^20 cycle 단위),
+    // LOAD 는 실행 큐의 부하 (nice 0 프로세스 하나가 1024), MIGIN/MIGOUT 은 옮겨오고 옮겨간 프로세스 수
+    printf(1, "CPU\tAPIC\tTICKS\tIDLE%%\tMCYC\tNRUN\tLOAD\tMIGIN\tMIGOUT\tCYC/TICK\n");
+    for(i = 0; i < ncs; i++) {
+      printf(1, "%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+             cs[i].cpu, cs[i].apicid, cs[i].ticks,
+             cs[i].ticks ? cs[i].idleticks * 100 / cs[i].ticks : 0,
+             (uint)(cs[i].idlecycles >> 20), cs[i].nrun, cs[i].load,
+             cs[i].nmigin, cs[i].nmigout, cs[i].cycpertick);
+    }
+    // RUN/RDY/SLP 는 TSC 로 잰 실행, 대기, 잠든 시간 (2^20 cycle 단위), MISS 는 EDF 가 놓친 deadline 수,
+    // INT 는 상호작용 점수 (작을수록 자주 잠든다), MIG 는 다른 CPU 로 옮겨간 횟수
+    printf(1, "PID\tSTATE\tCLS\tQ\tBURST\tWAIT\tIO\tEND\tCPU\tSWTCH\tRUN\tRDY\tSLP\tMISS\tINT\tMIG\tNAME\n");
+    for(i = 0; i < n; i++) {
+      printf(1, "%d\t%s\t%s\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n",
+             pi[i].pid, pi[i].state >= 0 && pi[i].state < 6 ? states[pi[i].state] : "???",
+             pi[i].class >= 0 && pi[i].class < NSCHEDCLASS ? classes[pi[i].class] : "???",
+             pi[i].q_level, pi[i].cpu_burst, pi[i].cpu_wait, pi[i].io_wait_time,
+             pi[i].end_time, pi[i].cpu, pi[i].nswtch, (uint)(pi[i].runcyc >> 20),
+             (uint)(pi[i].waitcyc >> 20), (uint)(pi[i].sleepcyc >> 20), pi[i].edfmiss, pi[i].interact,
+             pi[i].nmigrate, pi[i].name);
+    }
+
+    if(interval <= 0)
+      break;
+    sleep(interval);
+  }
+
+  exit();
+}
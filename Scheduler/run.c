@@ -0,0 +1,59 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "spawn.h"
+
+// spawn 으로 프로그램을 실행하고 끝날 때까지 기다리는 프로그램
+//   run [-q level] [-e end_time] [-o file] prog [args...]
+//   -q, -e   자식의 처음 MLFQ 단계와 CPU 사용 할당량 (하나라도 주면 MLFQ 클래스로 시작)
+//   -o       자식의 표준 출력을 file 로 보낸다
+
+int main(int argc, char **argv) {
+  struct spawnfa fa;
+  struct spawnattr attr;
+  int i, fd, pid, useattr;
+
+  fa.n = 0;
+  attr.q_level = 0;
+  attr.end_time = 0;
+  useattr = 0;
+  fd = -1;
+  for(i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+    if(strcmp(argv[i], "-q") == 0) {
+      attr.q_level = atoi(argv[i+1]);
+      useattr = 1;
+    } else if(strcmp(argv[i], "-e") == 0) {
+      attr.end_time = atoi(argv[i+1]);
+      useattr = 1;
+    } else if(strcmp(argv[i], "-o") == 0 && fd < 0) {
+      if((fd = open(argv[i+1], O_CREATE | O_WRONLY)) < 0) {
+        printf(2, "run: cannot open %s\n", argv[i+1]);
+        exit();
+      }
+      // 자식에서 fd 를 표준 출력으로 옮긴다
+      fa.act[fa.n].op = SPAWN_DUP2;
+      fa.act[fa.n].fd = fd;
+      fa.act[fa.n].newfd = 1;
+      fa.n++;
+      fa.act[fa.n].op = SPAWN_CLOSE;
+      fa.act[fa.n].fd = fd;
+      fa.n++;
+    } else
+      break;
+  }
+  if(i >= argc || argv[i][0] == '-') { // 입력 방식이 잘못됐을 경우 에러처리
+    printf(2, "usage : run [-q level] [-e end_time] [-o file] prog [args...]\n");
+    exit();
+  }
+
+  if((pid = spawn(argv[i], argv + i, &fa, useattr ? &attr : 0)) < 0) {
+    printf(2, "run: spawn %s failed\n", argv[i]);
+    exit();
+  }
+  if(fd >= 0)
+    close(fd);
+  wait();
+
+  exit();
+}
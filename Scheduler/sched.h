@@ -0,0 +1,98 @@
+// 스케줄러 설정 (sched_setconfig/sched_getconfig)
+#define MAXQLEVEL 8  // MLFQ 큐 단계 수의 최댓값
+
+struct schedconfig {
+  int nlevel;               // MLFQ 큐 단계 수 (1 ~ MAXQLEVEL, 0 이 가장 높은 우선순위)
+  int quantum[MAXQLEVEL];   // 단계별 time quantum (tick)
+  int aging;                // 큐에서 이 시간(tick) 이상 기다리면 한 단계 위로 올린다
+  int cfslatency;           // CFS: 실행 가능한 프로세스가 모두 한 번씩 실행되는 목표 주기 (tick)
+  int cfsmingran;           // CFS: 한 번 CPU 에 올라가면 적어도 이만큼은 실행한다 (tick, 1 ~ cfslatency)
+  int edfutil;              // EDF: 받아들이는 runtime/period 합의 한계 (CPU 하나당 %, 1 ~ 100)
+};
+
+// 스케줄링 클래스 (sched_setattr/sched_getattr)
+#define SCHED_MLFQ   0  // 다단계 피드백 큐 (기본)
+#define SCHED_STRIDE 1  // tickets 에 비례해 CPU 를 나눠 쓴다
+#define SCHED_CFS    2  // nice 가중치로 나눈 가상 실행 시간(vruntime)이 가장 작은 프로세스를 실행한다
+#define SCHED_EDF    3  // 주기마다 runtime 만큼, deadline 이 가장 이른 프로세스부터 실행한다 (실시간)
+#define NSCHEDCLASS  4
+
+#define STRIDE_DEFTICKETS   100    // tickets 를 정하지 않았을 때
+#define STRIDE_MAXTICKETS   10000
+#define STRIDE_OTHERTICKETS 100    // CFS, MLFQ 프로세스 전체가 함께 가지는 tickets
+
+#define CFS_MINNICE -20  // 가장 높은 가중치
+#define CFS_MAXNICE 19
+
+#define EDF_MAXPERIOD 10000  // tick
+
+// 프로세스의 스케줄링 클래스와 클래스별 인자.
+// fork 한 자식은 부모의 클래스와 인자를 물려받는다.
+struct schedattr {
+  int class;     // SCHED_*
+  int tickets;   // SCHED_STRIDE: 1 ~ STRIDE_MAXTICKETS. CPU 몫은 tickets / (전체 tickets)
+  int nice;      // SCHED_CFS: CFS_MINNICE ~ CFS_MAXNICE. 1 작을 때마다 CPU 몫이 약 1.25 배
+  int runtime;   // SCHED_EDF: 주기마다 쓸 CPU 시간 (tick, 1 ~ deadline)
+  int deadline;  // SCHED_EDF: 주기가 시작된 뒤 runtime 을 다 써야 하는 시간 (tick, 0 이면 period)
+  int period;    // SCHED_EDF: 주기 (tick, deadline ~ EDF_MAXPERIOD)
+};
+
+// 스케줄러 이벤트 추적 (/schedtrace 장치로 읽는다)
+#define SCHEDTRACE 2  // /schedtrace 장치의 major 번호 (file.h 의 CONSOLE 다음)
+
+#define SCHED_DISPATCH 1  // 프로세스를 CPU 에 올림
+#define SCHED_EXPIRE   2  // time quantum 또는 할당량(end_time)을 다 씀
+#define SCHED_DEMOTE   3  // 다음 단계 큐로 내려감
+#define SCHED_AGING    4  // Aging 으로 한 단계 위 큐로 올라감
+#define SCHED_EXIT     5  // 프로세스 종료
+#define SCHED_BOOST    6  // 자주 잠드는 프로세스가 깨어나면서 위 단계 큐로 올라감
+
+struct schedevent {
+  uint64 tsc;    // 기록할 때의 rdtsc 값
+  uint tick;     // 기록할 때의 ticks 값
+  uchar type;    // SCHED_* 이벤트 종류
+  uchar cpu;     // 이벤트가 일어난 CPU
+  uchar level;   // 이벤트 후 프로세스의 큐 단계
+  uchar pad;
+  int pid;
+  int slice;     // 이번 time quantum 에서 쓴 tick
+  int burst;     // 지금까지 쓴 CPU 시간 (cpu_burst)
+  int limit;     // CPU 사용 할당량 (end_time)
+};
+
+// 프로세스 정보 (getprocinfo 로 한 번에 여러 개를 받는다)
+struct procinfo {
+  int pid;
+  int state;         // enum procstate 값 (1 EMBRYO, 2 SLEEPING, 3 RUNNABLE, 4 RUNNING, 5 ZOMBIE)
+  int q_level;
+  int cpu_burst;
+  int cpu_wait;
+  int io_wait_time;
+  int end_time;
+  int cpu;           // 마지막으로 실행된 CPU (-1 이면 아직 실행된 적 없음)
+  int nswtch;        // CPU 에 올라간 횟수
+  char name[16];
+  int class;         // 스케줄링 클래스 (SCHED_*)
+  int tickets;       // SCHED_STRIDE 의 tickets
+  int nice;          // SCHED_CFS 의 nice
+  int edfmiss;       // SCHED_EDF 에서 deadline 을 넘겨 끝난 횟수
+  int interact;      // 상호작용 점수 (0 ~ 100, 작을수록 자주 잠든다)
+  int nmigrate;      // 다른 CPU 의 실행 큐로 옮겨간 횟수
+  uint64 runcyc;     // RUNNING 으로 보낸 시간 (TSC cycle)
+  uint64 waitcyc;    // RUNNABLE 로 실행 큐에서 기다린 시간
+  uint64 sleepcyc;   // SLEEPING 으로 보낸 시간
+};
+
+// CPU 정보 (getcpustat 으로 CPU 마다 하나씩 받는다)
+struct cpustat {
+  int cpu;
+  int apicid;
+  uint ticks;        // 받은 타이머 인터럽트 수
+  uint idleticks;    // 그 중 쉬고 있을 때 받은 수
+  uint64 idlecycles; // hlt 로 쉰 시간 (TSC cycle)
+  int nrun;          // 실행 큐에서 기다리는 프로세스 수
+  uint cycpertick;   // 1 tick 의 TSC cycle 수 (모든 CPU 가 같은 값)
+  uint load;         // 실행 큐의 부하 (nice 0 프로세스 하나가 1024)
+  uint nmigin;       // 다른 CPU 에서 옮겨온 프로세스 수
+  uint nmigout;      // 다른 CPU 로 옮겨간 프로세스 수
+};
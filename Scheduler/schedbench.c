@@ -0,0 +1,330 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "x86.h"
+#include "sched.h"
+
+// 스케줄러 벤치마크. 여러 종류의 자식 프로세스를 한꺼번에 fork 하고
+// 자식마다 turnaround, 처음 CPU 에 올라가기까지의 시간, 깨어난 뒤 CPU 에 올라가기까지의
+// 지연을 재서 종류별 백분위수를 출력한다.
+//   schedbench [-c ncpu] [-i nio] [-t ninteractive] [-d ndisk] [-w work] [-r rounds]
+//
+//   cpu          work 백만 번 반복 계산만 한다
+//   io           echo 자식과 pipe 로 rounds 번 주고받는다 (wakeup 지연 = echo 가 쓴 뒤 읽기가 끝나기까지)
+//   interactive  1~3 tick 마다 입력을 보내는 자식에게서 rounds 번 읽고 조금 계산한다
+//   disk         512 바이트 파일을 rounds 번 만들어 쓰고 닫는다 (지연 = 한 번 쓰는 데 걸린 시간)
+//
+// 시간은 rdtsc 로 재고, 시작할 때 uptime() 10 tick 동안의 cycle 수로 us 로 바꾼다 (1 tick = 10ms).
+// 결과는 한 줄에 "이름 class=종류 key=value ..." 형식으로 출력한다.
+
+#define CPU   0
+#define IO    1
+#define INTER 2
+#define DISK  3
+#define NKIND 4
+#define NCHILD 48 // 도우미 자식까지 NPROC 를 넘지 않도록
+
+static char *kindname[NKIND] = { "cpu", "io", "interactive", "disk" };
+
+struct result {
+  int kind;
+  int idx;
+  uint64 turnaround; // fork 직전부터 끝날 때까지 (cycle)
+  uint64 firstrun;   // fork 직전부터 자식이 처음 실행될 때까지
+  uint64 latsum;     // 지연의 합
+  uint64 latmax;
+  int nlat;
+};
+
+static uint cycpertick;
+
+// 64비트 나눗셈 (사용자 프로그램은 libgcc 없이 링크된다)
+static uint64
+div64(uint64 n, uint d)
+{
+  uint64 q = 0, r = 0;
+  int i;
+
+  for(i = 63; i >= 0; i--){
+    r = (r << 1) | ((n >> i) & 1);
+    if(r >= d){
+      r -= d;
+      q |= (uint64)1 << i;
+    }
+  }
+  return q;
+}
+
+static uint
+cyc2us(uint64 cyc)
+{
+  return (uint)div64(cyc * 100, cycpertick / 100);
+}
+
+static void
+calibrate(void)
+{
+  uint64 c0;
+  int t;
+
+  t = uptime();
+  while(uptime() == t)
+    ;
+  c0 = rdtsc();
+  t = uptime();
+  while(uptime() < t + 10)
+    ;
+  cycpertick = (uint)div64(rdtsc() - c0, 10);
+  if(cycpertick < 100)
+    cycpertick = 100;
+}
+
+static void
+spin(int n)
+{
+  volatile int x = 0;
+  int i;
+
+  for(i = 0; i < n; i++)
+    x += i;
+}
+
+static void
+lat(struct result *r, uint64 d)
+{
+  r->latsum += d;
+  if(d > r->latmax)
+    r->latmax = d;
+  r->nlat++;
+}
+
+//PAGEBREAK!
+static void
+runcpu(struct result *r, int work)
+{
+  int i;
+
+  for(i = 0; i < work; i++)
+    spin(1000000);
+}
+
+static void
+runio(struct result *r, int rounds)
+{
+  int to[2], from[2], i;
+  uint64 ts;
+
+  if(pipe(to) < 0 || pipe(from) < 0){
+    printf(2, "schedbench: pipe error\n");
+    exit();
+  }
+  if(fork() == 0){
+    close(to[1]);
+    close(from[0]);
+    while(read(to[0], &ts, sizeof(ts)) == sizeof(ts)){
+      ts = rdtsc();
+      write(from[1], &ts, sizeof(ts));
+    }
+    exit();
+  }
+  close(to[0]);
+  close(from[1]);
+  for(i = 0; i < rounds; i++){
+    ts = rdtsc();
+    write(to[1], &ts, sizeof(ts));
+    if(read(from[0], &ts, sizeof(ts)) != sizeof(ts))
+      break;
+    lat(r, rdtsc() - ts);
+  }
+  close(to[1]);
+  close(from[0]);
+  wait();
+}
+
+static void
+runinter(struct result *r, int rounds)
+{
+  int fd[2], i;
+  uint64 ts;
+
+  if(pipe(fd) < 0){
+    printf(2, "schedbench: pipe error\n");
+    exit();
+  }
+  if(fork() == 0){
+    close(fd[0]);
+    for(i = 0; i < rounds; i++){
+      sleep(1 + i % 3); // 사람이 입력하는 간격
+      ts = rdtsc();
+      write(fd[1], &ts, sizeof(ts));
+    }
+    exit();
+  }
+  close(fd[1]);
+  while(read(fd[0], &ts, sizeof(ts)) == sizeof(ts)){
+    lat(r, rdtsc() - ts);
+    spin(20000); // 입력 처리
+  }
+  close(fd[0]);
+  wait();
+}
+
+static void
+rundisk(struct result *r, int rounds)
+{
+  static char buf[512];
+  char name[] = "sbdisk00";
+  int fd, i;
+  uint64 ts;
+
+  name[6] += r->idx / 10 % 10;
+  name[7] += r->idx % 10;
+  for(i = 0; i < rounds; i++){
+    ts = rdtsc();
+    if((fd = open(name, O_CREATE | O_RDWR)) < 0)
+      break;
+    write(fd, buf, sizeof(buf));
+    close(fd);
+    lat(r, rdtsc() - ts);
+  }
+  unlink(name);
+}
+
+//PAGEBREAK!
+static void
+sort(uint *v, int n)
+{
+  int i, j;
+  uint x;
+
+  for(i = 1; i < n; i++){
+    x = v[i];
+    for(j = i; j > 0 && v[j-1] > x; j--)
+      v[j] = v[j-1];
+    v[j] = x;
+  }
+}
+
+static uint
+pct(uint *v, int n, int p)
+{
+  int i = (n * p + 99) / 100 - 1;
+
+  return v[i < 0 ? 0 : i];
+}
+
+// 종류가 kind 인 결과에서 which 번째 값을 골라 백분위수를 출력한다.
+//   0 turnaround, 1 firstrun, 2 자식별 평균 지연, 3 자식별 최대 지연
+static void
+report(char *name, struct result *res, int nres, int kind, int which)
+{
+  static uint v[NCHILD];
+  int i, n = 0;
+
+  for(i = 0; i < nres; i++){
+    if(res[i].kind != kind)
+      continue;
+    if(which >= 2 && res[i].nlat == 0)
+      continue;
+    switch(which){
+    case 0: v[n++] = cyc2us(res[i].turnaround); break;
+    case 1: v[n++] = cyc2us(res[i].firstrun); break;
+    case 2: v[n++] = cyc2us(div64(res[i].latsum, res[i].nlat)); break;
+    default: v[n++] = cyc2us(res[i].latmax); break;
+    }
+  }
+  if(n == 0)
+    return;
+  sort(v, n);
+  printf(1, "%s class=%s n=%d unit=us p50=%d p90=%d p99=%d max=%d\n",
+         name, kindname[kind], n, pct(v, n, 50), pct(v, n, 90), pct(v, n, 99), v[n-1]);
+}
+
+int main(int argc, char **argv) {
+  static struct result res[NCHILD];
+  static struct cpustat cs[8];
+  struct schedconfig sc;
+  struct result r;
+  int count[NKIND] = { 4, 2, 2, 1 };
+  int work = 100, rounds = 50;
+  int i, k, n, pid, nchild, nres, fd[2];
+  uint64 start;
+
+  for(i = 1; i + 1 < argc; i += 2) {
+    n = atoi(argv[i + 1]);
+    if(strcmp(argv[i], "-c") == 0) count[CPU] = n;
+    else if(strcmp(argv[i], "-i") == 0) count[IO] = n;
+    else if(strcmp(argv[i], "-t") == 0) count[INTER] = n;
+    else if(strcmp(argv[i], "-d") == 0) count[DISK] = n;
+    else if(strcmp(argv[i], "-w") == 0) work = n;
+    else if(strcmp(argv[i], "-r") == 0) rounds = n;
+    else break;
+  }
+  // io 와 interactive 는 도우미 자식을 하나씩 더 만든다
+  nchild = count[CPU] + count[IO] + count[INTER] + count[DISK];
+  if(i < argc || nchild <= 0 || nchild + count[IO] + count[INTER] > NCHILD || work < 0 || rounds < 0) {
+    printf(2, "usage : schedbench [-c ncpu] [-i nio] [-t ninteractive] [-d ndisk] [-w work] [-r rounds]\n");
+    exit();
+  }
+
+  if(sched_getconfig(&sc) < 0 || (n = getcpustat(cs, 8)) < 0) {
+    printf(2, "schedbench: cannot read scheduler config\n");
+    exit();
+  }
+  calibrate();
+  printf(1, "config ncpu=%d nlevel=%d aging=%d quantum=", n, sc.nlevel, sc.aging);
+  for(i = 0; i < sc.nlevel; i++)
+    printf(1, i ? ",%d" : "%d", sc.quantum[i]);
+  printf(1, " cyc_per_tick=%d work=%d rounds=%d\n", cycpertick, work, rounds);
+
+  // 자식은 결과를 pipe 로 보내고, 부모는 모든 자식을 fork 한 뒤에 읽는다
+  if(pipe(fd) < 0) {
+    printf(2, "schedbench: pipe error\n");
+    exit();
+  }
+  n = 0;
+  for(k = 0; k < NKIND; k++) {
+    for(i = 0; i < count[k]; i++, n++) {
+      start = rdtsc();
+      if((pid = fork()) < 0) {
+        printf(2, "schedbench: fork error\n");
+        break;
+      }
+      if(pid > 0)
+        continue;
+
+      memset(&r, 0, sizeof(r));
+      r.firstrun = rdtsc() - start;
+      r.kind = k;
+      r.idx = n;
+      close(fd[0]);
+      switch(k) {
+      case CPU: runcpu(&r, work); break;
+      case IO: runio(&r, rounds); break;
+      case INTER: runinter(&r, rounds); break;
+      case DISK: rundisk(&r, rounds); break;
+      }
+      r.turnaround = rdtsc() - start;
+      write(fd[1], &r, sizeof(r));
+      exit();
+    }
+  }
+  close(fd[1]);
+
+  for(nres = 0; nres < NCHILD && read(fd[0], &res[nres], sizeof(res[nres])) == sizeof(res[nres]); nres++)
+    ;
+  close(fd[0]);
+  while(wait() >= 0)
+    ;
+
+  for(k = 0; k < NKIND; k++) {
+    report("turnaround", res, nres, k, 0);
+    report("firstrun", res, nres, k, 1);
+    report("latency", res, nres, k, 2);
+    report("latmax", res, nres, k, 3);
+  }
+  printf(1, "done children=%d results=%d\n", nchild, nres);
+
+  exit();
+}
@@ -0,0 +1,486 @@
+// CFS (Completely Fair Scheduler) 스타일의 스케줄링 클래스.
+// 프로세스가 실행한 시간을 nice 가중치로 나눠 vruntime 에 더하고,
+// vruntime 이 가장 작은 프로세스를 실행한다. 실행 가능한 프로세스는 vruntime 순서의
+// red-black tree 에 두므로 넣고 빼는 데 O(log n), 다음 프로세스를 고르는 데 O(1) 이 든다.
+//
+// 한 번 CPU 에 올라가면 schedconf.cfslatency 를 가중치 비율로 나눈 만큼 (적어도
+// schedconf.cfsmingran) 실행한다. 프로세스가 많아 cfsmingran 으로 나눠도 cfslatency 를
+// 넘으면 주기를 프로세스 수 * cfsmingran 으로 늘린다.
+//
+// stride 클래스와 마찬가지로 낮은 우선순위의 클래스(MLFQ)에 있는 프로세스 전체는
+// nice 0 인 가상 프로세스 하나로 보고, 그 차례가 되면 pick 이 0 을 돌려준다.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "mcslock.h"
+#include "sched.h"
+#include "mlfq.h"
+#include "schedclass.h"
+
+// nice -20 ~ 19 의 가중치. nice 가 1 작으면 CPU 몫이 약 1.25 배가 된다 (Linux 와 같은 값).
+static const uint weight[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+// 2^32 / weight (반올림). 나눗셈 대신 곱셈으로 vruntime 을 구한다 (커널은 libgcc 없이 링크된다).
+static const uint invweight[40] = {
+      48388,     59856,     76040,     92818,    118348,
+     147320,    184698,    229616,    287308,    360437,
+     449829,    563644,    704093,    875809,   1099582,
+    1376151,   1717300,   2157191,   2708050,   3363326,
+    4194304,   5237765,   6557202,   8165337,  10153587,
+   12820798,  15790321,  19976592,  24970740,  31350126,
+   39045157,  49367440,  61356676,  76695845,  95443718,
+  119304647, 148102321, 186737709, 238609294, 286331153,
+};
+
+#define WEIGHT(p) weight[(p)->nice - CFS_MINNICE]
+
+// 실행 큐의 부하를 셀 때 쓰는 nice 의 가중치 (nice 0 이 NICE0LOAD)
+uint
+cfsweight(int nice)
+{
+  return weight[nice - CFS_MINNICE];
+}
+
+// a 의 vruntime 이 b 보다 작으면 1. 넘쳐서 한 바퀴 돌 수 있으므로 차이로 비교한다.
+#define VRLT(a, b) ((long long)((a) - (b)) < 0)
+
+#define ISRED(p) ((p) && (p)->rbred)
+
+// (a * b) >> 32. 32비트씩 나눠 곱해 96비트 곱을 피한다.
+static uint64
+mulshr32(uint64 a, uint b)
+{
+  return (a >> 32) * b + (((a & 0xffffffff) * b) >> 32);
+}
+
+// 실제로 실행한 시간 delta (TSC cycle) 를 p 의 가중치로 나눈 vruntime 증가량
+static uint64
+vdelta(struct proc *p, uint64 delta)
+{
+  return mulshr32(delta << 10, invweight[p->nice - CFS_MINNICE]);
+}
+
+//PAGEBREAK!
+// red-black tree. 자식이 없으면 0 이고, 0 은 검은 노드로 본다.
+static void
+rotleft(struct cfsrq *q, struct proc *x)
+{
+  struct proc *y = x->rbright;
+
+  x->rbright = y->rbleft;
+  if(y->rbleft)
+    y->rbleft->rbparent = x;
+  y->rbparent = x->rbparent;
+  if(x->rbparent == 0)
+    q->root = y;
+  else if(x == x->rbparent->rbleft)
+    x->rbparent->rbleft = y;
+  else
+    x->rbparent->rbright = y;
+  y->rbleft = x;
+  x->rbparent = y;
+}
+
+static void
+rotright(struct cfsrq *q, struct proc *x)
+{
+  struct proc *y = x->rbleft;
+
+  x->rbleft = y->rbright;
+  if(y->rbright)
+    y->rbright->rbparent = x;
+  y->rbparent = x->rbparent;
+  if(x->rbparent == 0)
+    q->root = y;
+  else if(x == x->rbparent->rbright)
+    x->rbparent->rbright = y;
+  else
+    x->rbparent->rbleft = y;
+  y->rbright = x;
+  x->rbparent = y;
+}
+
+// vruntime 순서로 넣는다. 같은 vruntime 끼리는 먼저 온 순서대로.
+static void
+rbinsert(struct cfsrq *q, struct proc *p)
+{
+  struct proc **link = &q->root, *parent = 0, *x, *gp, *uncle;
+  int leftmost = 1;
+
+  while(*link){
+    parent = *link;
+    if(VRLT(p->vruntime, parent->vruntime))
+      link = &parent->rbleft;
+    else {
+      link = &parent->rbright;
+      leftmost = 0;
+    }
+  }
+  p->rbparent = parent;
+  p->rbleft = p->rbright = 0;
+  p->rbred = 1;
+  *link = p;
+  if(leftmost)
+    q->leftmost = p;
+
+  for(x = p; (parent = x->rbparent) != 0 && parent->rbred; ){
+    gp = parent->rbparent; // 부모가 빨간 노드이므로 root 가 아니다
+    if(parent == gp->rbleft){
+      uncle = gp->rbright;
+      if(ISRED(uncle)){
+        parent->rbred = uncle->rbred = 0;
+        gp->rbred = 1;
+        x = gp;
+        continue;
+      }
+      if(x == parent->rbright){
+        rotleft(q, parent);
+        x = parent;
+        parent = x->rbparent;
+      }
+      parent->rbred = 0;
+      gp->rbred = 1;
+      rotright(q, gp);
+    } else {
+      uncle = gp->rbleft;
+      if(ISRED(uncle)){
+        parent->rbred = uncle->rbred = 0;
+        gp->rbred = 1;
+        x = gp;
+        continue;
+      }
+      if(x == parent->rbleft){
+        rotright(q, parent);
+        x = parent;
+        parent = x->rbparent;
+      }
+      parent->rbred = 0;
+      gp->rbred = 1;
+      rotleft(q, gp);
+    }
+  }
+  q->root->rbred = 0;
+}
+
+// p 다음으로 vruntime 이 큰 노드
+static struct proc*
+rbnext(struct proc *p)
+{
+  struct proc *parent;
+
+  if(p->rbright){
+    for(p = p->rbright; p->rbleft; p = p->rbleft)
+      ;
+    return p;
+  }
+  while((parent = p->rbparent) != 0 && p == parent->rbright)
+    p = parent;
+  return parent;
+}
+
+// p 바로 앞의 (vruntime 이 작은) 노드
+static struct proc*
+rbprev(struct proc *p)
+{
+  struct proc *parent;
+
+  if(p->rbleft){
+    for(p = p->rbleft; p->rbright; p = p->rbright)
+      ;
+    return p;
+  }
+  while((parent = p->rbparent) != 0 && p == parent->rbleft)
+    p = parent;
+  return parent;
+}
+
+// u 자리에 v 를 단다
+static void
+rbreplace(struct cfsrq *q, struct proc *u, struct proc *v)
+{
+  if(u->rbparent == 0)
+    q->root = v;
+  else if(u == u->rbparent->rbleft)
+    u->rbparent->rbleft = v;
+  else
+    u->rbparent->rbright = v;
+  if(v)
+    v->rbparent = u->rbparent;
+}
+
+// 검은 노드가 빠져 x (0 일 수 있으므로 부모 xp 를 함께 넘긴다) 쪽의
+// 검은 노드 수가 하나 모자라게 된 것을 고친다.
+static void
+rberasefix(struct cfsrq *q, struct proc *x, struct proc *xp)
+{
+  struct proc *w;
+
+  while(x != q->root && !ISRED(x)){
+    if(x == xp->rbleft){
+      w = xp->rbright;
+      if(w->rbred){
+        w->rbred = 0;
+        xp->rbred = 1;
+        rotleft(q, xp);
+        w = xp->rbright;
+      }
+      if(!ISRED(w->rbleft) && !ISRED(w->rbright)){
+        w->rbred = 1;
+        x = xp;
+        xp = x->rbparent;
+        continue;
+      }
+      if(!ISRED(w->rbright)){
+        w->rbleft->rbred = 0;
+        w->rbred = 1;
+        rotright(q, w);
+        w = xp->rbright;
+      }
+      w->rbred = xp->rbred;
+      xp->rbred = 0;
+      w->rbright->rbred = 0;
+      rotleft(q, xp);
+    } else {
+      w = xp->rbleft;
+      if(w->rbred){
+        w->rbred = 0;
+        xp->rbred = 1;
+        rotright(q, xp);
+        w = xp->rbleft;
+      }
+      if(!ISRED(w->rbleft) && !ISRED(w->rbright)){
+        w->rbred = 1;
+        x = xp;
+        xp = x->rbparent;
+        continue;
+      }
+      if(!ISRED(w->rbleft)){
+        w->rbright->rbred = 0;
+        w->rbred = 1;
+        rotleft(q, w);
+        w = xp->rbleft;
+      }
+      w->rbred = xp->rbred;
+      xp->rbred = 0;
+      w->rbleft->rbred = 0;
+      rotright(q, xp);
+    }
+    x = q->root;
+  }
+  if(x)
+    x->rbred = 0;
+}
+
+static void
+rberase(struct cfsrq *q, struct proc *z)
+{
+  struct proc *y, *x, *xp;
+  int wasred = z->rbred;
+
+  if(q->leftmost == z)
+    q->leftmost = rbnext(z);
+  if(z->rbleft == 0 || z->rbright == 0){
+    x = z->rbleft ? z->rbleft : z->rbright;
+    xp = z->rbparent;
+    rbreplace(q, z, x);
+  } else {
+    // 자식이 둘이면 바로 다음 노드 y 를 z 자리로 옮긴다
+    for(y = z->rbright; y->rbleft; y = y->rbleft)
+      ;
+    wasred = y->rbred;
+    x = y->rbright;
+    if(y->rbparent == z)
+      xp = y;
+    else {
+      xp = y->rbparent;
+      rbreplace(q, y, x);
+      y->rbright = z->rbright;
+      y->rbright->rbparent = y;
+    }
+    rbreplace(q, z, y);
+    y->rbleft = z->rbleft;
+    y->rbleft->rbparent = y;
+    y->rbred = z->rbred;
+  }
+  z->rbparent = z->rbleft = z->rbright = 0;
+  if(!wasred)
+    rberasefix(q, x, xp);
+}
+
+//PAGEBREAK!
+// 실행 큐에 넣는다. vruntime 이 다른 실행 큐 기준이면 이 큐의 minvr 기준으로 옮긴다.
+// 오래 잠들었던 프로세스는 minvr 에서 cfslatency 의 절반을 뺀 곳에 두어,
+// 깨어나면 곧 실행되지만 밀린 몫을 한꺼번에 쓰지는 못하게 한다.
+// front 가 0 이 아니면 slice 가 남아 있으므로 다음 pick 에서 이어서 실행한다.
+static void
+cfsenqueue(struct runq *rq, struct proc *p, int front)
+{
+  struct cfsrq *q = &rq->cfs;
+  int cpu = rq - runqs;
+  struct schedconfig sc;
+  uint64 floor;
+
+  if(p->cfscpu != cpu){
+    if(p->cfscpu >= 0)
+      p->vruntime -= runqs[p->cfscpu].cfs.minvr;
+    p->vruntime += q->minvr;
+    p->cfscpu = cpu;
+  }
+  schedconfread(&sc);
+  floor = q->minvr - (uint64)sc.cfslatency * cycpertick / 2;
+  if(VRLT(p->vruntime, floor))
+    p->vruntime = floor;
+
+  rbinsert(q, p);
+  q->n++;
+  q->totalweight += WEIGHT(p);
+  if(front)
+    q->next = p;
+}
+
+static void
+cfsdequeue(struct runq *rq, struct proc *p)
+{
+  struct cfsrq *q = &rq->cfs;
+
+  rberase(q, p);
+  q->n--;
+  q->totalweight -= WEIGHT(p);
+  if(q->next == p)
+    q->next = 0;
+}
+
+// p 가 이번에 실행할 tick 수. cfslatency 를 큐의 가중치 비율로 나눈다.
+// p 를 큐에서 빼기 전에 부른다.
+static int
+cfsslice(struct cfsrq *q, struct proc *p)
+{
+  struct schedconfig sc;
+  int period, slice;
+
+  schedconfread(&sc);
+  period = sc.cfslatency;
+  if(q->n * sc.cfsmingran > period)
+    period = q->n * sc.cfsmingran;
+  slice = period * WEIGHT(p) / q->totalweight;
+  return slice < sc.cfsmingran ? sc.cfsmingran : slice;
+}
+
+// slice 가 남은 프로세스가 있으면 그것을, 아니면 vruntime 이 가장 작은 프로세스를 꺼낸다.
+// 낮은 클래스에 프로세스가 있고 그쪽의 vruntime 이 더 작으면 0 을 돌려 차례를 넘긴다.
+static struct proc*
+cfspick(struct runq *rq, int nbelow)
+{
+  struct cfsrq *q = &rq->cfs;
+  struct proc *p;
+
+  if((p = q->next) == 0){
+    if((p = q->leftmost) == 0)
+      return 0;
+    if(nbelow > 0){
+      if(VRLT(q->othervr, q->minvr))
+        q->othervr = q->minvr;
+      if(VRLT(q->othervr, p->vruntime)){
+        q->othervr += cycpertick;
+        return 0;
+      }
+    }
+    p->cfsslice = cfsslice(q, p);
+    p->ticks = p->cpu_burst;
+  }
+  cfsdequeue(rq, p);
+  if(VRLT(q->minvr, p->vruntime))
+    q->minvr = p->vruntime;
+  return p;
+}
+
+// 다른 CPU 에는 그 CPU 가 가져갈 수 있는 것 중 vruntime 이 가장 큰 프로세스를 넘긴다.
+// 어느 큐로 갈지 모르므로 vruntime 은 이 큐의 minvr 에 대한 상대값으로 바꿔 둔다.
+static struct proc*
+cfssteal(struct runq *rq, int cpu, int cold)
+{
+  struct cfsrq *q = &rq->cfs;
+  struct proc *p;
+
+  if((p = q->root) == 0)
+    return 0;
+  while(p->rbright)
+    p = p->rbright;
+  while(p && !CANSTEAL(p, cpu, cold))
+    p = rbprev(p);
+  if(p == 0)
+    return 0;
+  p->cfsslice = cfsslice(q, p);
+  p->ticks = p->cpu_burst;
+  cfsdequeue(rq, p);
+  p->vruntime -= q->minvr;
+  p->cfscpu = -1;
+  return p;
+}
+
+// 실행한 시간만큼 vruntime 을 더하고, slice 가 남았으면 이어서 실행하게 한다.
+static int
+cfsput(struct proc *p)
+{
+  int time_slice = p->cpu_burst - p->ticks;
+
+  p->vruntime += vdelta(p, p->runcyc - p->cfsstart);
+  p->cfsstart = p->runcyc;
+  if(mlfq_done(p->cpu_burst, p->end_time) && !MLFQ_PRIVILEGED(p->pid))
+    return PUT_KILL;
+  if(time_slice < p->cfsslice)
+    return PUT_FRONT;
+  p->ticks = p->cpu_burst;
+  schedtrace(SCHED_EXPIRE, p, time_slice);
+  return PUT_BACK;
+}
+
+// 부모가 CFS 클래스면 nice 를 물려받는다. 다른 클래스에서 옮겨오면
+// sched_setattr 가 정한 nice 를 쓴다. 어느 쪽이든 들어가는 실행 큐의 minvr 에서 시작한다.
+static void
+cfsfork(struct proc *parent, struct proc *p)
+{
+  if(parent && parent->class == SCHED_CFS)
+    p->nice = parent->nice;
+  p->vruntime = 0;
+  p->cfscpu = -1;
+  p->cfsstart = p->runcyc;
+  p->cfsslice = 0;
+  p->ticks = p->cpu_burst;
+}
+
+static int
+cfssetattr(struct proc *p, struct schedattr *attr)
+{
+  if(attr->nice < CFS_MINNICE || attr->nice > CFS_MAXNICE)
+    return -1;
+  p->nice = attr->nice;
+  return 0;
+}
+
+struct schedclass cfsclass = {
+  .name = "cfs",
+  .enqueue = cfsenqueue,
+  .dequeue = cfsdequeue,
+  .pick = cfspick,
+  .steal = cfssteal,
+  .tick = 0,
+  .put = cfsput,
+  .fork = cfsfork,
+  .setattr = cfssetattr,
+};
@@ -0,0 +1,107 @@
+// 스케줄링 클래스.
+// 프로세스는 하나의 클래스(p->class)에 속하고, CPU 마다 있는 실행 큐(struct runq)는
+// 클래스마다 자기 몫의 큐를 가진다. proc.c 는 클래스를 우선순위 순서대로 물어
+// 다음에 실행할 프로세스를 고르고, 큐를 다루는 일은 각 클래스가 한다.
+//
+// 잠금: enqueue, dequeue, pick, steal, tick 은 해당 runq 의 lock 을 잡고 부른다.
+// put, fork, setattr, leave, wake 는 그 프로세스의 p->lock 을 잡고 부르고, ready 는
+// lock 없이 부른다. 클래스 전체가 함께 쓰는 상태는 클래스가 자기 lock 으로 보호한다.
+
+struct proc;
+struct runq;
+struct schedattr;
+
+// p 가 CPU cpu 에서 실행될 수 있으면 1 (sched_setaffinity)
+#define CANRUN(p, cpu) (((p)->affinity >> (cpu)) & 1)
+
+// 다른 CPU 가 p 를 가져가도 되면 1. cold 가 0 이 아니면 (부하 분산)
+// 캐시가 식은 프로세스만 가져간다 (proc.c 의 cachecold).
+#define CANSTEAL(p, cpu, cold) (CANRUN(p, cpu) && (!(cold) || cachecold(p)))
+
+// 실행 큐의 부하를 셀 때 nice 0 인 프로세스 하나의 가중치
+#define NICE0LOAD 1024
+
+// put 의 결과
+#define PUT_FRONT 0  // RUNNABLE 이면 큐의 맨 앞에 다시 넣는다
+#define PUT_BACK  1  // RUNNABLE 이면 큐의 맨 뒤에 다시 넣는다
+#define PUT_KILL  2  // CPU 사용 할당량을 다 썼으니 종료시킨다
+#define PUT_HOLD  3  // 클래스가 붙잡아 두었다가 ready 로 돌려준다
+
+struct schedclass {
+  char *name;
+  void (*enqueue)(struct runq *rq, struct proc *p, int front); // RUNNABLE 이 된 p 를 큐에 넣는다
+  void (*dequeue)(struct runq *rq, struct proc *p);            // 큐에 있는 p 를 뺀다
+  struct proc *(*pick)(struct runq *rq, int nbelow); // 다음에 실행할 프로세스를 큐에서 꺼낸다 (없으면 0).
+                                                      // nbelow 는 더 낮은 클래스에서 기다리는 프로세스 수
+  struct proc *(*steal)(struct runq *rq, int cpu, int cold); // CPU cpu 가 가져갈 프로세스를 꺼낸다 (없으면 0).
+                                                   // CANSTEAL(p, cpu, cold) 인 프로세스만 넘긴다
+  void (*tick)(struct runq *rq);           // 스케줄러가 tick 마다 부른다 (Aging 등). 0 이면 없음
+  int (*put)(struct proc *p);              // p 가 CPU 를 내려놓았다. PUT_* 를 돌려준다
+  void (*fork)(struct proc *parent, struct proc *p); // 새로 만들어졌거나 (parent 는 부모, 없으면 0)
+                                                     // 다른 클래스에서 옮겨온 p 의 클래스 정보를 정한다
+  int (*setattr)(struct proc *p, struct schedattr *attr); // 클래스별 인자를 검사해 p 에 넣는다.
+                                                          // 받아들일 수 없으면 -1. 0 이면 인자 없음
+  int (*leave)(struct proc *p);            // p 가 클래스를 떠난다 (종료, 클래스 변경). 0 이면 없음.
+                                           // PUT_HOLD 로 붙잡고 있던 p 면 1 을 돌려준다
+  void (*wake)(struct proc *p);            // 잠들었던 p 가 깨어나 큐에 들어가기 직전에 부른다. 0 이면 없음
+  struct proc *(*ready)(void);             // PUT_HOLD 로 붙잡은 프로세스 중 다시 실행할 때가 된 것을
+                                           // 하나 돌려준다 (없으면 0). CPU 0 이 tick 마다 부른다. 0 이면 없음
+};
+
+// MLFQ 클래스의 큐 (schedmlfq.c)
+struct mlfqrq {
+  struct proc *head[MAXQLEVEL];   // 단계별 큐의 맨 앞 (p->qnext 로 연결)
+  struct proc *tail[MAXQLEVEL];   // 단계별 큐의 맨 뒤
+  uint bitmap;                    // 비어 있지 않은 단계의 비트 (bit n = Qn)
+  uint agetick;                   // 마지막으로 Aging 을 검사한 tick
+};
+
+// stride 클래스의 큐 (schedstride.c)
+struct striderq {
+  struct proc *head;              // pass 가 작은 순서로 정렬 (p->qnext 로 연결)
+  int n;                          // 큐에 있는 프로세스 수
+  uint pass;                      // 마지막으로 고른 pass (새로 들어오는 프로세스의 기준)
+  uint otherpass;                 // 다른 클래스 전체를 하나로 본 가상 프로세스의 pass
+};
+
+// CFS 클래스의 큐 (schedcfs.c)
+struct cfsrq {
+  struct proc *root;              // vruntime 순서의 red-black tree
+  struct proc *leftmost;          // vruntime 이 가장 작은 프로세스
+  struct proc *next;              // slice 가 남아 다음에 이어서 실행할 프로세스 (없으면 0)
+  int n;                          // 큐에 있는 프로세스 수
+  uint totalweight;               // 큐에 있는 프로세스의 가중치 합
+  uint64 minvr;                   // 단조 증가하는 vruntime 기준 (새로 들어오는 프로세스의 기준)
+  uint64 othervr;                 // 낮은 클래스 전체를 nice 0 하나로 본 가상 프로세스의 vruntime
+};
+
+// EDF 클래스의 큐 (schededf.c)
+struct edfrq {
+  struct proc *head;              // deadline 이 이른 순서로 정렬 (p->qnext 로 연결)
+};
+
+// CPU 마다 하나씩 가지는 실행 큐.
+// 큐에는 RUNNABLE 상태이면서 아직 어떤 CPU 에도 선택되지 않은
+// 프로세스만 들어있다. 큐를 건드릴 때는 해당 큐의 lock 만 잡으면 되고,
+// p->lock 을 잡은 상태에서 큐의 lock 을 잡는 순서만 허용한다 (proc.c 의 잠금 순서).
+struct runq {
+  struct mcslock lock;
+  volatile int nrun;              // 큐에 들어있는 전체 프로세스 수 (lock 없이 읽는다)
+  volatile uint load;             // 큐에 들어있는 프로세스의 가중치 합 (lock 없이 읽는다)
+  int nclass[NSCHEDCLASS];        // 클래스별 프로세스 수
+  struct mlfqrq mlfq;
+  struct striderq stride;
+  struct cfsrq cfs;
+  struct edfrq edf;
+};
+
+extern struct runq runqs[NCPU];
+extern struct schedclass mlfqclass;
+extern struct schedclass strideclass;
+extern struct schedclass cfsclass;
+extern struct schedclass edfclass;
+extern uint cycpertick;
+
+int cachecold(struct proc *p);
+void schedconfread(struct schedconfig *sc);
+uint cfsweight(int nice);
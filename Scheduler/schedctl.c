@@ -0,0 +1,62 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "sched.h"
+
+// 스케줄러 설정을 출력하거나 바꾸는 프로그램
+//   schedctl                        현재 설정 출력
+//   schedctl <aging> <q0> [q1 ...]  Aging 기준과 단계별 time quantum 설정
+//   schedctl cfs <latency> <mingran> CFS 의 목표 주기와 최소 실행 시간 설정 (tick)
+//   schedctl edf <util>              EDF 프로세스가 예약할 수 있는 CPU 시간의 한계 설정 (CPU 하나당 %)
+int main(int argc, char **argv) {
+  struct schedconfig sc;
+  int i;
+
+  if(argc == 2 || argc > MAXQLEVEL + 2 ||
+     (argc > 2 && strcmp(argv[1], "cfs") == 0 && argc != 4) ||
+     (argc > 2 && strcmp(argv[1], "edf") == 0 && argc != 3)) { // 입력 방식이 잘못됐을 경우 에러처리
+    printf(2, "usage : schedctl [<aging> <q0> [q1 ...] | cfs <latency> <mingran> | edf <util>]\n");
+    exit();
+  }
+
+  // 바꾸지 않는 설정은 그대로 두도록 현재 설정에서 시작한다
+  if(argc > 2 && sched_getconfig(&sc) < 0) {
+    printf(2, "sched_getconfig error\n");
+    exit();
+  }
+
+  if(argc > 2 && (strcmp(argv[1], "cfs") == 0 || strcmp(argv[1], "edf") == 0)) {
+    if(argv[1][0] == 'c') {
+      sc.cfslatency = atoi(argv[2]);
+      sc.cfsmingran = atoi(argv[3]);
+    } else
+      sc.edfutil = atoi(argv[2]);
+    if(sched_setconfig(&sc) < 0) {
+      printf(2, "sched_setconfig error\n");
+      exit();
+    }
+  } else if(argc > 2) {
+    sc.aging = atoi(argv[1]);
+    sc.nlevel = argc - 2; // 넘겨준 time quantum 개수가 큐 단계 수
+    for(i = 0; i < sc.nlevel; i++)
+      sc.quantum[i] = atoi(argv[i + 2]);
+
+    if(sched_setconfig(&sc) < 0) {
+      printf(2, "sched_setconfig error\n");
+      exit();
+    }
+  }
+
+  if(sched_getconfig(&sc) < 0) {
+    printf(2, "sched_getconfig error\n");
+    exit();
+  }
+
+  printf(1, "levels %d, aging %d, quantum", sc.nlevel, sc.aging);
+  for(i = 0; i < sc.nlevel; i++)
+    printf(1, " %d", sc.quantum[i]);
+  printf(1, "\ncfs latency %d, mingran %d\n", sc.cfslatency, sc.cfsmingran);
+  printf(1, "edf util %d%%\n", sc.edfutil);
+
+  exit();
+}
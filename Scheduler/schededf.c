@@ -0,0 +1,233 @@
+// EDF (Earliest Deadline First) 실시간 스케줄링 클래스.
+// 프로세스는 period tick 마다 runtime tick 의 CPU 시간을 예약하고, 주기가 시작된 뒤
+// deadline tick 안에 그 시간을 다 쓰기를 바란다. 실행 큐에서는 이번 주기의 deadline 이
+// 가장 이른 프로세스를 먼저 실행하고, 다른 클래스보다 항상 먼저 실행한다.
+//
+// 실시간 프로세스가 다른 클래스를 굶기지 않도록 이번 주기의 runtime 을 다 쓰면
+// 다음 주기가 시작될 때까지 실행 큐 밖에 붙잡아 둔다 (PUT_HOLD).
+// 예약한 runtime/period 의 합은 schedconf.edfutil% * CPU 수를 넘지 못한다 (admission control).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "mcslock.h"
+#include "sched.h"
+#include "mlfq.h"
+#include "schedclass.h"
+
+// runtime/period 를 BW1 을 1 로 하는 고정 소수점으로 나타낸다
+#define BW1 (1 << 16)
+#define BW(runtime, period) ((uint)(runtime) * BW1 / (uint)(period))
+
+// a 가 b 보다 이른 tick 이면 1. ticks 는 넘쳐서 한 바퀴 돌 수 있으므로 차이로 비교한다.
+#define TICKLT(a, b) ((int)((a) - (b)) < 0)
+
+// 다음 주기를 기다리는 프로세스 (p->qnext 로 연결)와 받아들인 runtime/period 의 합.
+// 둘 다 edflock 으로 보호한다. p->lock 과 함께 잡을 때는 p->lock 을 먼저 잡는다.
+static struct mcslock edflock;
+static struct proc *held;
+static uint edfbw;
+
+// 새 주기를 시작한다
+static void
+edfreplenish(struct proc *p)
+{
+  p->edfleft = p->edfruntime;
+  p->edfdl = ticks + p->edfdeadline;
+  p->edfnext = ticks + p->edfperiod;
+}
+
+// deadline 순서를 지키며 큐에 넣는다. 같은 deadline 끼리는 먼저 온 순서대로.
+// 주기가 지났으면 새 주기를 시작한다. 잠든 사이에 runtime 을 다 썼던 프로세스가
+// 주기 안에 깨어나면, 다음 주기의 runtime 을 당겨 쓰는 대신 deadline 도 한 주기 미룬다.
+static void
+edfenqueue(struct runq *rq, struct proc *p, int front)
+{
+  struct proc **pp, *prev = 0;
+
+  if(!TICKLT(ticks, p->edfnext))
+    edfreplenish(p);
+  else if(p->edfleft <= 0){
+    p->edfleft += p->edfruntime;
+    p->edfdl += p->edfperiod;
+    p->edfnext += p->edfperiod;
+  }
+  for(pp = &rq->edf.head; *pp && !TICKLT(p->edfdl, (*pp)->edfdl); pp = &(*pp)->qnext)
+    prev = *pp;
+  p->qnext = *pp;
+  p->qprev = prev;
+  if(p->qnext)
+    p->qnext->qprev = p;
+  *pp = p;
+}
+
+static void
+edfdequeue(struct runq *rq, struct proc *p)
+{
+  if(p->qprev)
+    p->qprev->qnext = p->qnext;
+  else
+    rq->edf.head = p->qnext;
+  if(p->qnext)
+    p->qnext->qprev = p->qprev;
+  p->qnext = p->qprev = 0;
+}
+
+// deadline 이 가장 이른 프로세스를 꺼낸다. 낮은 클래스는 기다리게 한다.
+static struct proc*
+edfpick(struct runq *rq, int nbelow)
+{
+  struct proc *p;
+
+  if((p = rq->edf.head) == 0)
+    return 0;
+  edfdequeue(rq, p);
+  return p;
+}
+
+// 다른 CPU 에는 그 CPU 가 가져갈 수 있는 것 중 deadline 이 가장 늦은 프로세스를 넘긴다.
+static struct proc*
+edfsteal(struct runq *rq, int cpu, int cold)
+{
+  struct proc *p, *victim = 0;
+
+  for(p = rq->edf.head; p; p = p->qnext)
+    if(CANSTEAL(p, cpu, cold))
+      victim = p;
+  if(victim)
+    edfdequeue(rq, victim);
+  return victim;
+}
+
+// 실행한 tick 만큼 이번 주기의 runtime 에서 뺀다. 이번 일을 끝냈는데 (잠들었거나
+// runtime 을 다 씀) deadline 이 지났으면 놓친 것으로 센다. 주기 하나는 한 번만 센다.
+// runtime 을 다 썼고 아직 다음 주기가 아니면 붙잡아 둔다.
+static int
+edfput(struct proc *p)
+{
+  int time_slice = p->cpu_burst - p->ticks;
+
+  p->ticks = p->cpu_burst;
+  p->edfleft -= time_slice;
+  if(mlfq_done(p->cpu_burst, p->end_time) && !MLFQ_PRIVILEGED(p->pid))
+    return PUT_KILL;
+  if((p->state != RUNNABLE || p->edfleft <= 0) && TICKLT(p->edfdl, ticks) &&
+     p->edfmissdl != p->edfdl){
+    p->edfmiss++;
+    p->edfmissdl = p->edfdl;
+  }
+  if(p->state != RUNNABLE || p->edfleft > 0 || !TICKLT(ticks, p->edfnext))
+    return PUT_BACK;
+  schedtrace(SCHED_EXPIRE, p, time_slice);
+  mcsacquire(&edflock);
+  p->qnext = held;
+  held = p;
+  p->edfheld = 1;
+  mcsrelease(&edflock);
+  return PUT_HOLD;
+}
+
+// 다음 주기가 시작된 프로세스를 하나 돌려준다. 실행 큐에 들어갈 때 runtime 을 다시 채운다.
+static struct proc*
+edfready(void)
+{
+  struct proc **pp, *p;
+
+  mcsacquire(&edflock);
+  for(pp = &held; (p = *pp) != 0; pp = &p->qnext){
+    if(!TICKLT(ticks, p->edfnext)){
+      *pp = p->qnext;
+      p->qnext = 0;
+      p->edfheld = 0;
+      break;
+    }
+  }
+  mcsrelease(&edflock);
+  return p;
+}
+
+// EDF 클래스에 들어오면 다음에 실행 큐에 들어갈 때 새 주기를 시작한다.
+// 자식은 EDF 를 물려받지 않으므로 parent 는 늘 0 이다 (schedfork).
+static void
+edffork(struct proc *parent, struct proc *p)
+{
+  p->edfleft = 0;
+  p->edfnext = ticks;
+  p->edfmissdl = ticks; // 앞으로의 deadline 은 모두 이보다 늦다
+  p->ticks = p->cpu_burst;
+}
+
+// 인자를 검사하고, 예약한 CPU 시간의 합이 한계를 넘지 않을 때만 받아들인다.
+// 이미 EDF 프로세스면 원래 예약을 빼고 다시 계산한다. 바뀐 runtime 은 다음 주기부터 쓴다.
+static int
+edfsetattr(struct proc *p, struct schedattr *attr)
+{
+  int deadline = attr->deadline ? attr->deadline : attr->period;
+  struct schedconfig sc;
+  uint bw, old = 0;
+
+  if(attr->runtime < 1 || attr->runtime > deadline ||
+     deadline > attr->period || attr->period > EDF_MAXPERIOD)
+    return -1;
+  bw = BW(attr->runtime, attr->period);
+  if(p->class == SCHED_EDF)
+    old = BW(p->edfruntime, p->edfperiod);
+  schedconfread(&sc);
+  mcsacquire(&edflock);
+  if(edfbw - old + bw > (uint)sc.edfutil * BW1 / 100 * ncpu){
+    mcsrelease(&edflock);
+    return -1;
+  }
+  edfbw = edfbw - old + bw;
+  mcsrelease(&edflock);
+  p->edfruntime = attr->runtime;
+  p->edfdeadline = deadline;
+  p->edfperiod = attr->period;
+  return 0;
+}
+
+// 예약을 돌려받는다. 붙잡아 둔 프로세스면 목록에서 빼고 1 을 돌려준다.
+static int
+edfleave(struct proc *p)
+{
+  struct proc **pp;
+
+  mcsacquire(&edflock);
+  edfbw -= BW(p->edfruntime, p->edfperiod);
+  if(!p->edfheld){
+    mcsrelease(&edflock);
+    return 0;
+  }
+  for(pp = &held; *pp != p; pp = &(*pp)->qnext)
+    ;
+  *pp = p->qnext;
+  p->qnext = 0;
+  p->edfheld = 0;
+  mcsrelease(&edflock);
+  return 1;
+}
+
+struct schedclass edfclass = {
+  .name = "edf",
+  .enqueue = edfenqueue,
+  .dequeue = edfdequeue,
+  .pick = edfpick,
+  .steal = edfsteal,
+  .tick = 0,
+  .put = edfput,
+  .fork = edffork,
+  .setattr = edfsetattr,
+  .leave = edfleave,
+  .ready = edfready,
+};
+
+void
+edfinit(void)
+{
+  mcsinit(&edflock, "edf");
+}
@@ -0,0 +1,293 @@
+// MLFQ 스케줄링 클래스.
+// 단계마다 도착 순서대로 줄을 세우고, 비어 있지 않은 단계 중 우선순위가 가장 높은
+// 단계의 맨 앞 프로세스를 실행한다. 언제 내리고 올리고 종료시킬지는
+// mlfq.c 의 정책 함수가 정한다.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "mcslock.h"
+#include "sched.h"
+#include "mlfq.h"
+#include "schedclass.h"
+
+// 실행 중에 sched_setconfig 로 바꿀 수 있는 MLFQ, CFS, EDF 설정.
+// 바꾸는 쪽은 conflock 을 잡고 confseq 를 홀수로 만든 동안 고친다 (seqlock).
+// 스케줄러는 lock 없이 schedconfread 로 복사본을 떠서 쓰므로 반쯤 바뀐 설정
+// (예: 늘어난 nlevel 과 아직 그대로인 quantum) 을 보지 않는다.
+static struct schedconfig schedconf = {
+  4, {10, 20, 40, 80}, 250, 10, 1, 95
+};
+static volatile uint confseq;
+static struct mcslock conflock;
+
+// 지금의 설정을 sc 에 복사한다. 복사하는 동안 바뀌었으면 다시 복사한다.
+void
+schedconfread(struct schedconfig *sc)
+{
+  uint seq;
+
+  do {
+    while((seq = confseq) & 1)
+      ;
+    __sync_synchronize();
+    memmove(sc, &schedconf, sizeof(*sc));
+    __sync_synchronize();
+  } while(confseq != seq);
+}
+
+// 실행 큐의 p->q_level 단계에 프로세스를 넣는다.
+// front 가 0 이 아니면 큐의 맨 앞에 넣어 남은 time quantum 을 이어서 쓰게 한다.
+// 줄의 순서와 상관없이 qtick 은 늘 지금부터 기다리기 시작한 tick 이고, 이 단계에서 전에
+// 기다린 시간은 cpu_wait 에 모아 둔다 (mlfqdequeue). 그래서 실행한 시간은 기다린 시간에 들어가지 않는다.
+static void
+mlfqenqueue(struct runq *rq, struct proc *p, int front)
+{
+  struct mlfqrq *q = &rq->mlfq;
+  int level = p->q_level;
+
+  p->qtick = ticks;
+  if(front){
+    p->qprev = 0;
+    p->qnext = q->head[level];
+    if(p->qnext)
+      p->qnext->qprev = p;
+    else
+      q->tail[level] = p;
+    q->head[level] = p;
+  } else {
+    p->qnext = 0;
+    p->qprev = q->tail[level];
+    if(p->qprev)
+      p->qprev->qnext = p;
+    else
+      q->head[level] = p;
+    q->tail[level] = p;
+  }
+  q->bitmap |= 1 << level;
+}
+
+// p->q_level 단계 큐에서 프로세스를 빼낸다. 큐가 비면 bitmap 의 비트를 지운다.
+static void
+mlfqdequeue(struct runq *rq, struct proc *p)
+{
+  struct mlfqrq *q = &rq->mlfq;
+  int level = p->q_level;
+
+  if(p->qprev)
+    p->qprev->qnext = p->qnext;
+  else
+    q->head[level] = p->qnext;
+  if(p->qnext)
+    p->qnext->qprev = p->qprev;
+  else
+    q->tail[level] = p->qprev;
+  p->qnext = p->qprev = 0;
+  p->cpu_wait += ticks - p->qtick; // 이 단계에서 큐에서 기다린 시간
+  if(q->head[level] == 0)
+    q->bitmap &= ~(1 << level);
+}
+
+// 우선순위가 가장 높은 단계의 맨 앞 프로세스를 꺼낸다.
+// bitmap 의 가장 낮은 비트가 비어 있지 않은 가장 높은 우선순위 단계다.
+static struct proc*
+mlfqpick(struct runq *rq, int nbelow)
+{
+  struct proc *p;
+  int level;
+
+  if((level = mlfq_pick(rq->mlfq.bitmap)) < 0)
+    return 0;
+  p = rq->mlfq.head[level];
+  mlfqdequeue(rq, p);
+  return p;
+}
+
+// 다른 CPU 가 훔쳐갈 프로세스: 가장 낮은 우선순위 큐의 맨 뒤 프로세스.
+// 그 CPU 가 가져갈 수 없으면 앞으로, 위 단계로 가며 찾는다.
+static struct proc*
+mlfqsteal(struct runq *rq, int cpu, int cold)
+{
+  struct proc *p;
+  uint bitmap = rq->mlfq.bitmap;
+  int level;
+
+  for(; (level = mlfq_victim(bitmap)) >= 0; bitmap &= ~(1 << level)){
+    for(p = rq->mlfq.tail[level]; p; p = p->qprev){
+      if(CANSTEAL(p, cpu, cold)){
+        mlfqdequeue(rq, p);
+        return p;
+      }
+    }
+  }
+  return 0;
+}
+
+// 큐에서 schedconf.aging 이상 기다린 프로세스를 한 단계 위 큐의 맨 뒤로 올린다.
+// 넣을 때마다 qtick 을 새로 찍으므로 각 단계는 기다리기 시작한 순서대로 줄을 서고,
+// 단계마다 맨 앞부터 보다가 아직 Aging 할 때가 안 된 첫 프로세스에서 멈춘다.
+// tick 당 한 번만 검사한다. init 과 sh 는 Aging 대상에서 제외하되 건너뛰고 계속 본다.
+static void
+mlfqtick(struct runq *rq)
+{
+  struct schedconfig sc;
+  struct proc *p, *next;
+  int level;
+
+  if(rq->mlfq.agetick == ticks)
+    return;
+  rq->mlfq.agetick = ticks;
+  schedconfread(&sc);
+  for(level = 1; level < sc.nlevel; level++){
+    for(p = rq->mlfq.head[level]; p; p = next){
+      next = p->qnext;
+      if(MLFQ_PRIVILEGED(p->pid))
+        continue;
+      if(!mlfq_aged(&sc, p->pid, ticks, p->qtick - p->cpu_wait))
+        break;
+      mlfqdequeue(rq, p);
+      p->q_level = level - 1;
+      p->cpu_wait = 0;
+      schedtrace(SCHED_AGING, p, 0);
+      mlfqenqueue(rq, p, 0);
+    }
+  }
+}
+
+// 방금 CPU 를 내려놓은 프로세스에 MLFQ 정책(mlfq.c)의 결정을 적용한다.
+// time quantum 이 남았으면 같은 큐의 맨 앞, 다 썼으면 다음 단계 큐의 맨 뒤로 보내고,
+// CPU 사용 할당량(end_time)을 다 썼으면 종료시키게 한다.
+static int
+mlfqput(struct proc *p)
+{
+  struct schedconfig sc;
+  int level, decision;
+  int time_slice = p->cpu_burst - p->ticks;
+
+  schedconfread(&sc);
+  // 실행 중에 단계 수가 줄었으면 가장 낮은 단계로 옮긴다
+  p->q_level = level = mlfq_clamp(&sc, p->q_level);
+
+  decision = mlfq_decide(&sc, p->pid, level, time_slice, p->cpu_burst, p->end_time);
+
+  // 아직 time quantum 이 남아 있으면 같은 큐의 맨 앞에서 이어서 실행
+  if(decision == MLFQ_RESUME)
+    return PUT_FRONT;
+
+  p->ticks = p->cpu_burst;
+  schedtrace(SCHED_EXPIRE, p, time_slice);
+
+// 프로세스가 할당량을 다 쓴 경우 종료
+  if(decision == MLFQ_EXIT)
+    return PUT_KILL;
+
+// 다음 우선순위 큐로 프로세스 이동
+  if(decision == MLFQ_DEMOTE){
+    p->q_level = mlfq_next(&sc, level, decision);
+    schedtrace(SCHED_DEMOTE, p, time_slice);
+  }
+  p->cpu_wait = 0;
+  return PUT_BACK;
+}
+
+// 잠들었던 프로세스가 깨어날 때, 최근에 잠든 시간이 실행한 시간보다 충분히 길면
+// (자주 block 되는 대화형, I/O 프로세스) 위 단계로 올려 time quantum 을 새로 시작한다.
+// CPU 를 주로 쓰는 프로세스는 내려간 단계에 그대로 둔다.
+static void
+mlfqwake(struct proc *p)
+{
+  struct schedconfig sc;
+  int level;
+
+  schedconfread(&sc);
+  level = mlfq_clamp(&sc, p->q_level);
+  level = mlfq_wakelevel(&sc, p->pid, level, mlfq_interact(p->ivrun, p->ivslp));
+  if(level < p->q_level){
+    p->q_level = level;
+    p->ticks = p->cpu_burst;
+    p->cpu_wait = 0;
+    schedtrace(SCHED_BOOST, p, 0);
+  }
+}
+
+// 새로 만들어졌거나 다른 클래스에서 옮겨온 프로세스는 처음 단계에서
+// time quantum 을 새로 시작한다.
+static void
+mlfqfork(struct proc *parent, struct proc *p)
+{
+  struct schedconfig sc;
+
+  schedconfread(&sc);
+  p->q_level = mlfq_initlevel(&sc, p->pid); // init 과 sh 는 가장 낮은 큐, 나머지는 가장 높은 큐
+  p->ticks = p->cpu_burst;
+}
+
+struct schedclass mlfqclass = {
+  .name = "mlfq",
+  .enqueue = mlfqenqueue,
+  .dequeue = mlfqdequeue,
+  .pick = mlfqpick,
+  .steal = mlfqsteal,
+  .tick = mlfqtick,
+  .put = mlfqput,
+  .fork = mlfqfork,
+  .wake = mlfqwake,
+};
+
+void
+mlfqinit(void)
+{
+  mcsinit(&conflock, "schedconf");
+}
+
+// 스케줄러 설정을 바꾼다. 잘못된 설정이면 -1 을 돌려준다.
+// 줄어든 단계의 큐에 남아 있는 프로세스는 가장 낮은 단계의 맨 뒤로 옮기고,
+// 실행 중인 프로세스는 CPU 를 내려놓을 때 mlfqput 에서 옮긴다.
+int
+sched_setconfig(struct schedconfig *sc)
+{
+  struct runq *rq;
+  struct proc *p;
+  int i, level;
+
+  if(mlfq_checkconfig(sc) < 0)
+    return -1;
+  if(sc->cfsmingran < 1 || sc->cfsmingran > sc->cfslatency || sc->cfslatency > 100)
+    return -1;
+  if(sc->edfutil < 1 || sc->edfutil > 100) // 이미 받아들인 EDF 프로세스는 그대로 둔다
+    return -1;
+
+  mcsacquire(&conflock);
+  confseq++;
+  __sync_synchronize();
+  memmove(&schedconf, sc, sizeof(schedconf));
+  __sync_synchronize();
+  confseq++;
+  mcsrelease(&conflock);
+
+  for(i = 0; i < ncpu; i++){
+    rq = &runqs[i];
+    mcsacquire(&rq->lock);
+    for(level = sc->nlevel; level < MAXQLEVEL; level++){
+      while((p = rq->mlfq.head[level]) != 0){
+        mlfqdequeue(rq, p);
+        p->q_level = sc->nlevel - 1;
+        mlfqenqueue(rq, p, 0);
+      }
+    }
+    mcsrelease(&rq->lock);
+  }
+  return 0;
+}
+
+// 현재 스케줄러 설정을 sc 에 복사한다.
+void
+sched_getconfig(struct schedconfig *sc)
+{
+  schedconfread(sc);
+}
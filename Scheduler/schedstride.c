@@ -0,0 +1,169 @@
+// stride (비례 배분) 스케줄링 클래스.
+// 프로세스마다 tickets 에 반비례하는 stride 를 두고, CPU 를 내려놓을 때마다
+// pass 에 stride 를 더한다. pass 가 가장 작은 프로세스를 실행하므로
+// 오래 보면 각 프로세스는 tickets 에 비례하는 만큼 CPU 를 쓴다.
+//
+// 아래 우선순위의 클래스(CFS, MLFQ)에 있는 프로세스 전체는 STRIDE_OTHERTICKETS 장을 가진
+// 가상 프로세스 하나로 본다. 그 차례가 되면 pick 이 0 을 돌려주어 다음 클래스에 넘긴다.
+// 그래서 stride 프로세스는 다른 프로세스가 있어도 정해진 몫을 받고, 다른 프로세스도
+// 굶지 않는다. pass 는 CPU 를 실제로 쓴 시간만큼 더하므로 tick 도중에 잠드는 프로세스는
+// 그만큼 덜 청구된다.
+//
+// 실행 큐마다 pass 가 따로 흘러가므로 p->pass 는 p->stridecpu 의 큐를 기준으로 한 값이고,
+// 다른 큐로 옮겨 갈 때 (steal, 새 프로세스) 그 큐의 pass 기준으로 바꾼다. CFS 의 vruntime 과 같다.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "mcslock.h"
+#include "sched.h"
+#include "mlfq.h"
+#include "schedclass.h"
+
+#define STRIDE1 (1 << 20)  // tickets 가 1 장일 때의 stride
+
+// a 의 pass 가 b 보다 작으면 1. pass 는 넘쳐서 한 바퀴 돌 수 있으므로 차이로 비교한다.
+#define PASSLT(a, b) ((int)((a) - (b)) < 0)
+
+// pass 순서를 지키며 큐에 넣는다. 같은 pass 끼리는 먼저 온 순서대로.
+// 오래 잠들었던 프로세스가 밀린 몫을 한꺼번에 쓰지 않도록
+// pass 는 큐의 현재 pass 보다 작아지지 않게 한다.
+static void
+strideenqueue(struct runq *rq, struct proc *p, int front)
+{
+  struct striderq *q = &rq->stride;
+  struct proc **pp, *prev = 0;
+  int cpu = rq - runqs;
+
+  if(p->stridecpu != cpu){
+    if(p->stridecpu >= 0)
+      p->pass -= runqs[p->stridecpu].stride.pass;
+    p->pass += q->pass;
+    p->stridecpu = cpu;
+  }
+  if(PASSLT(p->pass, q->pass))
+    p->pass = q->pass;
+  for(pp = &q->head; *pp && !PASSLT(p->pass, (*pp)->pass); pp = &(*pp)->qnext)
+    prev = *pp;
+  p->qnext = *pp;
+  p->qprev = prev;
+  if(p->qnext)
+    p->qnext->qprev = p;
+  *pp = p;
+  q->n++;
+}
+
+static void
+stridedequeue(struct runq *rq, struct proc *p)
+{
+  struct striderq *q = &rq->stride;
+
+  if(p->qprev)
+    p->qprev->qnext = p->qnext;
+  else
+    q->head = p->qnext;
+  if(p->qnext)
+    p->qnext->qprev = p->qprev;
+  p->qnext = p->qprev = 0;
+  q->n--;
+}
+
+// pass 가 가장 작은 프로세스를 꺼낸다.
+// 낮은 클래스에 프로세스가 있고 그쪽의 pass 가 더 작으면 0 을 돌려 차례를 넘긴다.
+static struct proc*
+stridepick(struct runq *rq, int nbelow)
+{
+  struct striderq *q = &rq->stride;
+  struct proc *p;
+
+  if((p = q->head) == 0)
+    return 0;
+  if(nbelow > 0){
+    if(PASSLT(q->otherpass, q->pass))
+      q->otherpass = q->pass;
+    if(PASSLT(q->otherpass, p->pass)){
+      q->pass = q->otherpass;
+      q->otherpass += STRIDE1 / STRIDE_OTHERTICKETS;
+      return 0;
+    }
+  }
+  stridedequeue(rq, p);
+  q->pass = p->pass;
+  return p;
+}
+
+// 다른 CPU 에는 그 CPU 가 가져갈 수 있는 것 중 pass 가 가장 큰 (가장 늦게 차례가 오는) 프로세스를 넘긴다.
+static struct proc*
+stridesteal(struct runq *rq, int cpu, int cold)
+{
+  struct proc *p, *victim = 0;
+
+  for(p = rq->stride.head; p; p = p->qnext)
+    if(CANSTEAL(p, cpu, cold))
+      victim = p;
+  if(victim)
+    stridedequeue(rq, victim);
+  return victim;
+}
+
+// 지난번 put 뒤로 실행한 tick 만큼 pass 를 더한다. cpu_burst 는 측정한 실행 시간 (runcyc) 을
+// cycpertick 으로 나눈 값이고 나머지는 다음 번으로 넘기므로 (cycacct), 1 tick 이 안 되게
+// 쓰고 내려놓은 것도 모이면 청구된다.
+static int
+strideput(struct proc *p)
+{
+  int time_slice = p->cpu_burst - p->ticks;
+
+  p->ticks = p->cpu_burst;
+  p->pass += time_slice * (STRIDE1 / p->tickets);
+  if(mlfq_done(p->cpu_burst, p->end_time) && !MLFQ_PRIVILEGED(p->pid))
+    return PUT_KILL;
+  return PUT_BACK;
+}
+
+// 부모가 stride 클래스면 tickets 와 pass 를 물려받는다.
+// 그렇지 않으면 (다른 클래스에서 옮겨오면) sched_setattr 가 정한 tickets 를 쓰고,
+// pass 는 처음 들어가는 실행 큐의 pass 에서 시작한다 (strideenqueue).
+// tickets 를 정하는 길은 이 둘뿐이다. spawnattr 는 MLFQ 상태만 담으므로 spawn 으로
+// tickets 를 줄 수 없다 (spawn.h).
+static void
+stridefork(struct proc *parent, struct proc *p)
+{
+  p->ticks = p->cpu_burst;
+  if(parent && parent->class == SCHED_STRIDE){
+    p->tickets = parent->tickets;
+    p->pass = parent->pass;
+    p->stridecpu = parent->stridecpu;
+    return;
+  }
+  if(p->tickets <= 0)
+    p->tickets = STRIDE_DEFTICKETS;
+  p->pass = 0;
+  p->stridecpu = -1;
+}
+
+static int
+stridesetattr(struct proc *p, struct schedattr *attr)
+{
+  if(attr->tickets < 1 || attr->tickets > STRIDE_MAXTICKETS)
+    return -1;
+  p->tickets = attr->tickets;
+  return 0;
+}
+
+struct schedclass strideclass = {
+  .name = "stride",
+  .enqueue = strideenqueue,
+  .dequeue = stridedequeue,
+  .pick = stridepick,
+  .steal = stridesteal,
+  .tick = 0,
+  .put = strideput,
+  .fork = stridefork,
+  .setattr = stridesetattr,
+};
@@ -0,0 +1,70 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "sched.h"
+
+#define NEV 32
+#define NELEM(x) (sizeof(x)/sizeof((x)[0]))
+
+static char *evname[] = {
+  [SCHED_DISPATCH] "dispatch",
+  [SCHED_EXPIRE]   "expire",
+  [SCHED_DEMOTE]   "demote",
+  [SCHED_AGING]    "aging",
+  [SCHED_EXIT]     "exit",
+  [SCHED_BOOST]    "boost",
+};
+
+// 32비트 값을 앞을 0 으로 채운 16진수 8자리로 출력
+static void
+printhex8(uint x)
+{
+  static char digits[] = "0123456789abcdef";
+  char buf[8];
+  int i;
+
+  for(i = 7; i >= 0; i--, x >>= 4)
+    buf[i] = digits[x & 0xf];
+  write(1, buf, 8);
+}
+
+// /schedtrace 장치에서 스케줄러 이벤트를 읽어 한 줄씩 출력하는 프로그램
+// -f 를 주면 종료하지 않고 계속 새 이벤트를 기다린다
+// 출력 형식: tick tsc cpu event pid level slice burst limit
+int main(int argc, char **argv) {
+  struct schedevent ev[NEV];
+  int fd, n, i, follow;
+
+  follow = (argc > 1 && strcmp(argv[1], "-f") == 0);
+
+  if((fd = open("schedtrace", O_RDONLY)) < 0) { // 장치 파일이 없으면 만든다
+    mknod("schedtrace", SCHEDTRACE, 0);
+    fd = open("schedtrace", O_RDONLY);
+  }
+  if(fd < 0) {
+    printf(2, "open error for schedtrace\n");
+    exit();
+  }
+
+  for(;;) {
+    n = read(fd, ev, sizeof(ev)) / sizeof(ev[0]);
+    if(n <= 0) {
+      if(!follow)
+        break;
+      sleep(10);
+      continue;
+    }
+    for(i = 0; i < n; i++) {
+      printf(1, "%d ", ev[i].tick);
+      printhex8(ev[i].tsc >> 32);
+      printhex8(ev[i].tsc);
+      printf(1, " %d %s %d %d %d %d %d\n", ev[i].cpu,
+             ev[i].type < NELEM(evname) && evname[ev[i].type] ? evname[ev[i].type] : "?",
+             ev[i].pid, ev[i].level, ev[i].slice, ev[i].burst, ev[i].limit);
+    }
+  }
+
+  close(fd);
+  exit();
+}
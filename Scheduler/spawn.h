@@ -0,0 +1,26 @@
+// spawn 의 인자 (커널과 사용자 프로그램이 함께 쓴다)
+
+#define NSPAWNFA 16  // 한 번에 적용할 수 있는 파일 동작의 최대 수
+
+// 파일 동작
+#define SPAWN_CLOSE 1  // fd 를 닫는다
+#define SPAWN_DUP2  2  // fd 를 newfd 에도 연다 (newfd 가 열려 있으면 먼저 닫는다)
+
+// 자식의 파일 표에 부모의 열린 파일을 물려준 뒤 act[0] 부터 차례로 적용한다.
+struct spawnfa {
+  int n;  // act 의 항목 수
+  struct {
+    int op;     // SPAWN_*
+    int fd;
+    int newfd;  // SPAWN_DUP2 만 쓴다
+  } act[NSPAWNFA];
+};
+
+// 자식의 처음 스케줄링 상태. 주면 자식은 부모의 클래스와 상관없이 MLFQ 클래스로
+// 시작하며, 실행되기 전에 정해지므로 자식이 set_proc_info 를 부르지 않아도 된다.
+// 클래스와 tickets 는 담지 않는다. 다른 클래스로 시작하게 하려면 attr 없이 그 클래스의
+// 부모가 spawn 해서 물려주거나, 만든 뒤에 sched_setattr 로 바꾼다.
+struct spawnattr {
+  int q_level;   // MLFQ 처음 단계 (0 ~ nlevel-1)
+  int end_time;  // CPU 사용 할당량 (tick, 0 이면 없음)
+};
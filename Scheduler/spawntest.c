@@ -0,0 +1,71 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "spawn.h"
+
+// spawn 으로 만든 자식이 실제로 실행되는지 확인하는 프로그램.
+// echo 를 표준 출력을 파일로 돌려 실행하고, wait 가 그 자식을 거두는지와 파일에 남은 출력을 본다.
+// 잘못된 경로와 파일 동작은 spawn 이 -1 을 돌려주는지 본다.
+
+#define OUTFILE "spawntest.out"
+
+static void
+fail(char *msg)
+{
+  printf(2, "spawntest: FAIL %s\n", msg);
+  unlink(OUTFILE);
+  exit();
+}
+
+int main(int argc, char **argv) {
+  char *args[] = { "echo", "spawn", "ok", 0 };
+  char *bad[] = { "nosuchprog", 0 };
+  char buf[32];
+  struct spawnfa fa;
+  struct spawnattr attr;
+  int fd, pid, n;
+
+  if((fd = open(OUTFILE, O_CREATE | O_WRONLY)) < 0)
+    fail("open");
+
+  fa.n = 2;
+  fa.act[0].op = SPAWN_DUP2;  // 자식의 표준 출력을 파일로
+  fa.act[0].fd = fd;
+  fa.act[0].newfd = 1;
+  fa.act[1].op = SPAWN_CLOSE;
+  fa.act[1].fd = fd;
+  attr.q_level = 1;
+  attr.end_time = 0;
+
+  if((pid = spawn("echo", args, &fa, &attr)) < 0)
+    fail("spawn echo");
+  close(fd);
+  if(wait() != pid) // 자식이 끝나야 (죽지 않고 exit 해야) 거둘 수 있다
+    fail("wait");
+
+  if((fd = open(OUTFILE, O_RDONLY)) < 0)
+    fail("reopen");
+  n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if(n < 0)
+    fail("read");
+  buf[n] = 0;
+  if(strcmp(buf, "spawn ok\n") != 0)
+    fail("output");
+
+  if(spawn("nosuchprog", bad, 0, 0) >= 0)
+    fail("bad path");
+  fa.n = 1;
+  fa.act[0].op = SPAWN_CLOSE;
+  fa.act[0].fd = -1;
+  if(spawn("echo", args, &fa, 0) >= 0)
+    fail("bad file action");
+  attr.q_level = -1;
+  if(spawn("echo", args, 0, &attr) >= 0)
+    fail("bad attr");
+
+  unlink(OUTFILE);
+  printf(1, "spawntest: ok\n");
+  exit();
+}
@@ -13,16 +13,26 @@
 // library system call function. The saved user %esp points
 // to a saved program counter, and then the first argument.
 
+// [addr, addr+n) 이 프로세스의 메모리 (sz 아래이거나 mmap 한 영역 하나) 안에 있으면 1
+static int
+validuva(uint addr, uint n)
+{
+  struct proc *curproc = myproc();
+
+  if(addr + n < addr)
+    return 0;
+  if(addr < curproc->sz && addr + n <= curproc->sz)
+    return 1;
+  return addr + n <= mmapend(addr);
+}
+
 // Fetch the int at addr from the current process.
 int
 fetchint(uint addr, int *ip)
 {
-  struct proc *curproc = myproc();
-
-  if(addr >= curproc->sz || addr+4 > curproc->sz)
+  if(!validuva(addr, 4))
     return -1;
-  *ip = *(int*)(addr);
-  return 0;
+  return copyuser(ip, (void*)addr, sizeof(*ip));
 }
 
 // Fetch the nul-terminated string at addr from the current process.
@@ -34,10 +44,11 @@ fetchstr(uint addr, char **pp)
   char *s, *ep;
   struct proc *curproc = myproc();
 
-  if(addr >= curproc->sz)
+  if(addr < curproc->sz)
+    ep = (char*)curproc->sz;
+  else if((ep = (char*)mmapend(addr)) == 0)
     return -1;
   *pp = (char*)addr;
-  ep = (char*)curproc->sz;
   for(s = *pp; s < ep; s++){
     if(*s == 0)
       return s - *pp;
@@ -59,11 +70,30 @@ int
 argptr(int n, char **pp, int size)
 {
   int i;
-  struct proc *curproc = myproc();
- 
+
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  if(size < 0 || !validuva((uint)i, size))
+    return -1;
+  if(pagein((uint)i, size, 0) < 0) // 아직 채우지 않은 sbrk, mmap 페이지를 채운다
+    return -1;
+  *pp = (char*)i;
+  return 0;
+}
+
+// argptr 와 같지만 커널이 결과를 써 넣을 버퍼를 받는다. 쓰기 폴트로 미리 채우므로
+// PROT_WRITE 가 없는 mmap 영역이면 -1 이다. 커널이 lock 을 잡은 채 쓰다가 폴트를 내면
+// 처리할 수 없으므로 (mmapfault), 사용자 메모리에 쓰는 시스템 호출은 이것으로 받는다.
+int
+argoutptr(int n, char **pp, int size)
+{
+  int i;
+
+  if(argint(n, &i) < 0)
+    return -1;
+  if(size < 0 || !validuva((uint)i, size))
+    return -1;
+  if(pagein((uint)i, size, 1) < 0)
     return -1;
   *pp = (char*)i;
   return 0;
@@ -105,6 +135,20 @@ extern int sys_write(void);
 extern int sys_uptime(void);
 extern int sys_lseek(void); // 함수를 선언하며 이 함수의 존재를 컴파일러에게 알려줌
 extern int sys_set_proc_info(void);
+extern int sys_sched_setconfig(void);
+extern int sys_sched_getconfig(void);
+extern int sys_getprocinfo(void);
+extern int sys_getcpustat(void);
+extern int sys_sched_setattr(void);
+extern int sys_sched_getattr(void);
+extern int sys_sched_setaffinity(void);
+extern int sys_sched_getaffinity(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_getlockstat(void);
+extern int sys_spawn(void);
+extern int sys_mmap(void);
+extern int sys_munmap(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -130,6 +174,20 @@ static int (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_lseek]   sys_lseek, // SYS_lseek 시스템 콜을 sys_lseek 함수와 연결
 [SYS_set_proc_info]   sys_set_proc_info,
+[SYS_sched_setconfig] sys_sched_setconfig,
+[SYS_sched_getconfig] sys_sched_getconfig,
+[SYS_getprocinfo]     sys_getprocinfo,
+[SYS_getcpustat]      sys_getcpustat,
+[SYS_sched_setattr]   sys_sched_setattr,
+[SYS_sched_getattr]   sys_sched_getattr,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_getlockstat] sys_getlockstat,
+[SYS_spawn]   sys_spawn,
+[SYS_mmap]    sys_mmap,
+[SYS_munmap]  sys_munmap,
 };
 
 void
@@ -22,3 +22,17 @@
 #define SYS_close  21
 #define SYS_lseek  22
 #define SYS_set_proc_info  23
+#define SYS_sched_setconfig 24
+#define SYS_sched_getconfig 25
+#define SYS_getprocinfo 26
+#define SYS_getcpustat 27
+#define SYS_sched_setattr 28
+#define SYS_sched_getattr 29
+#define SYS_sched_setaffinity 30
+#define SYS_sched_getaffinity 31
+#define SYS_clone 32
+#define SYS_join 33
+#define SYS_getlockstat 34
+#define SYS_spawn 35
+#define SYS_mmap 36
+#define SYS_munmap 37
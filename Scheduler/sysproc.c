@@ -11,6 +11,11 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "sched.h"
+#include "mlfq.h"
+#include "mcslock.h"
+#include "spawn.h"
+#include "mmap.h"
 
 int
 sys_set_proc_info(void)
@@ -21,66 +26,164 @@ sys_set_proc_info(void)
   int io_wait_time;
   int end_time;
 
-  struct proc *p = myproc();
-  p->q_level = 0;
-  p->cpu_burst = 0;
-  p->cpu_wait = 0;
-  p->io_wait_time = 0;
-  p->end_time = -1;
+  struct schedconfig sc;
 
-  if(argint(0, &q_level) >= 0 && argint(0, &q_level) <= 3) {
-    p->q_level = q_level; 
-  }
-    
-  if(argint(1, &cpu_burst) >= 0) {
-    p->cpu_burst = cpu_burst;
-  }
-    
-  if(argint(2, &cpu_wait_time) >= 0) {
-    p->cpu_wait = cpu_wait_time;
-  }
-    
-  if(argint(3, &io_wait_time) >= 0) {
-    p->io_wait_time = io_wait_time;
-  }
-    
-  if(argint(4, &end_time) >= 0) {
-    p->end_time = end_time;
-  }
+  sched_getconfig(&sc);
+  // 받지 못한 인자는 기본값으로 둔다
+  if(argint(0, &q_level) < 0 || q_level < 0 || mlfq_clamp(&sc, q_level) != q_level)
+    q_level = 0;
+  if(argint(1, &cpu_burst) < 0)
+    cpu_burst = 0;
+  if(argint(2, &cpu_wait_time) < 0)
+    cpu_wait_time = 0;
+  if(argint(3, &io_wait_time) < 0)
+    io_wait_time = 0;
+  if(argint(4, &end_time) < 0)
+    end_time = -1;
 
-  if(p->q_level != 0) {
-    qP0--;
-    if(p->q_level == 1) {
-      qP1++;
-      Q1[qP1] = p;
-      sigQ = 1;
-      sig_level = 1;
-    }
-    else if(p->q_level == 2) {
-      qP2++;
-      Q2[qP2] = p;
-      sigQ = 1; 
-      sig_level = 2;
-    }
-    else if(p->q_level == 3) {
-      qP3++;
-      Q2[qP2] = p;
-      sigQ = 1;
-      sig_level = 3;
-    }
-  }  
-  else {
-    sigQ = 1;
-    sig_level = 0;
-  }
+  set_proc_info(q_level, cpu_burst, cpu_wait_time, io_wait_time, end_time);
 
 #ifdef DEBUG
-  cprintf("set process %d's info complete\n", p->pid);
+  cprintf("set process %d's info complete\n", myproc()->pid);
 #endif
 
   return 0;
 }
 
+int
+sys_sched_setconfig(void)
+{
+  struct schedconfig *usc, sc;
+
+  if(argptr(0, (char**)&usc, sizeof(*usc)) < 0)
+    return -1;
+  if(copyuser(&sc, usc, sizeof(sc)) < 0) // 검사하는 동안 바뀌지 않도록 먼저 복사
+    return -1;
+  return sched_setconfig(&sc);
+}
+
+int
+sys_sched_getconfig(void)
+{
+  struct schedconfig *usc, sc;
+
+  if(argoutptr(0, (char**)&usc, sizeof(*usc)) < 0)
+    return -1;
+  sched_getconfig(&sc);
+  return copyuser(usc, &sc, sizeof(sc));
+}
+
+int
+sys_getprocinfo(void)
+{
+  struct procinfo *pi;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NPROC)
+    n = NPROC;
+  if(argoutptr(0, (char**)&pi, n*sizeof(*pi)) < 0)
+    return -1;
+  return getprocinfo(pi, n);
+}
+
+int
+sys_sched_setattr(void)
+{
+  struct schedattr *uattr, attr;
+  int pid;
+
+  if(argint(0, &pid) < 0 || argptr(1, (char**)&uattr, sizeof(*uattr)) < 0)
+    return -1;
+  if(copyuser(&attr, uattr, sizeof(attr)) < 0) // 검사하는 동안 바뀌지 않도록 먼저 복사
+    return -1;
+  return sched_setattr(pid, &attr);
+}
+
+int
+sys_sched_getattr(void)
+{
+  struct schedattr *attr;
+  int pid;
+
+  if(argint(0, &pid) < 0 || argoutptr(1, (char**)&attr, sizeof(*attr)) < 0)
+    return -1;
+  return sched_getattr(pid, attr);
+}
+
+int
+sys_sched_setaffinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+  return sched_setaffinity(pid, mask);
+}
+
+int
+sys_sched_getaffinity(void)
+{
+  uint *mask;
+  int pid;
+
+  if(argint(0, &pid) < 0 || argoutptr(1, (char**)&mask, sizeof(*mask)) < 0)
+    return -1;
+  return sched_getaffinity(pid, mask);
+}
+
+int
+sys_clone(void)
+{
+  int fcn, arg1, arg2, stack;
+
+  if(argint(0, &fcn) < 0 || argint(1, &arg1) < 0 ||
+     argint(2, &arg2) < 0 || argint(3, &stack) < 0)
+    return -1;
+  return clone((void(*)(void*, void*))fcn, (void*)arg1, (void*)arg2, (void*)stack);
+}
+
+int
+sys_join(void)
+{
+  void **stack;
+
+  if(argoutptr(0, (char**)&stack, sizeof(*stack)) < 0)
+    return -1;
+  return join(stack);
+}
+
+int
+sys_getlockstat(void)
+{
+  struct lockstat *ls;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NMCSLOCK)
+    n = NMCSLOCK;
+  if(argoutptr(0, (char**)&ls, n*sizeof(*ls)) < 0)
+    return -1;
+  return getlockstat(ls, n);
+}
+
+int
+sys_getcpustat(void)
+{
+  struct cpustat *cs;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NCPU)
+    n = NCPU;
+  if(argoutptr(0, (char**)&cs, n*sizeof(*cs)) < 0)
+    return -1;
+  return getcpustat(cs, n);
+}
+
 int 
 sys_lseek(void) { // sys_lseek() 함수 구현   
   int fd; // 파일디스크립터 번호
@@ -181,16 +284,16 @@ sys_sleep(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
+  mcsacquire(&tickslock);
   ticks0 = ticks;
   while(ticks - ticks0 < n){
     if(myproc()->killed){
-      release(&tickslock);
+      mcsrelease(&tickslock);
       return -1;
     }
-    sleep(&ticks, &tickslock);
+    mcssleep(&ticks, &tickslock);
   }
-  release(&tickslock);
+  mcsrelease(&tickslock);
   return 0;
 }
 
@@ -201,8 +304,84 @@ sys_uptime(void)
 {
   uint xticks;
 
-  acquire(&tickslock);
+  mcsacquire(&tickslock);
   xticks = ticks;
-  release(&tickslock);
+  mcsrelease(&tickslock);
   return xticks;
 }
+
+// spawn(path, argv, fa, attr). argv 는 exec 처럼 0 으로 끝나는 문자열 포인터 배열이고,
+// fa 와 attr 은 0 이면 주지 않은 것이다.
+int
+sys_spawn(void)
+{
+  char *path, *argv[MAXARG];
+  int i, ufa, uattr;
+  uint uargv, uarg;
+  struct spawnfa *fa, kfa;
+  struct spawnattr *attr, kattr;
+
+  if(argstr(0, &path) < 0 || argint(1, (int*)&uargv) < 0 ||
+     argint(2, &ufa) < 0 || argint(3, &uattr) < 0)
+    return -1;
+  // 검사하는 동안 바뀌지 않도록 먼저 복사
+  fa = 0;
+  if(ufa){
+    if(argptr(2, (char**)&fa, sizeof(*fa)) < 0)
+      return -1;
+    if(copyuser(&kfa, fa, sizeof(kfa)) < 0)
+      return -1;
+    fa = &kfa;
+  }
+  attr = 0;
+  if(uattr){
+    if(argptr(3, (char**)&attr, sizeof(*attr)) < 0)
+      return -1;
+    if(copyuser(&kattr, attr, sizeof(kattr)) < 0)
+      return -1;
+    attr = &kattr;
+  }
+
+  memset(argv, 0, sizeof(argv));
+  for(i=0;; i++){
+    if(i >= NELEM(argv))
+      return -1;
+    if(fetchint(uargv+4*i, (int*)&uarg) < 0)
+      return -1;
+    if(uarg == 0){
+      argv[i] = 0;
+      break;
+    }
+    if(fetchstr(uarg, &argv[i]) < 0)
+      return -1;
+  }
+  return spawn(path, argv, fa, attr);
+}
+
+// mmap(addr, len, prot, flags, fd, off). addr 는 쓰지 않고 커널이 빈 주소를 고른다.
+// 실패하면 MAP_FAILED (-1).
+int
+sys_mmap(void)
+{
+  int len, prot, flags, fd, off;
+  struct file *f;
+
+  if(argint(1, &len) < 0 || argint(2, &prot) < 0 || argint(3, &flags) < 0 ||
+     argint(4, &fd) < 0 || argint(5, &off) < 0 || len <= 0 || off < 0)
+    return -1;
+  f = 0;
+  if(!(flags & MAP_ANON) &&
+     (fd < 0 || fd >= NOFILE || (f = myproc()->ofile[fd]) == 0))
+    return -1;
+  return mmap(len, prot, flags, f, off);
+}
+
+int
+sys_munmap(void)
+{
+  int addr, len;
+
+  if(argint(0, &addr) < 0 || argint(1, &len) < 0 || len <= 0)
+    return -1;
+  return munmap(addr, len);
+}
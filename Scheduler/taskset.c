@@ -0,0 +1,55 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// 프로세스가 실행될 수 있는 CPU 를 출력하거나 바꾸는 프로그램
+//   taskset <pid>          CPU mask 출력 (pid 0 은 자기 자신)
+//   taskset <pid> <mask>   CPU mask 설정 (16진수, bit n = CPU n. 예: 0x3 은 CPU 0, 1)
+
+// 16진수 문자열을 읽는다. 앞의 0x 는 있어도 되고, 16진수가 아니면 -1.
+static int
+atoh(char *s, uint *v)
+{
+  int c;
+
+  if(s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    s += 2;
+  if(*s == 0)
+    return -1;
+  for(*v = 0; (c = *s) != 0; s++){
+    if(c >= '0' && c <= '9')
+      c -= '0';
+    else if(c >= 'a' && c <= 'f')
+      c -= 'a' - 10;
+    else if(c >= 'A' && c <= 'F')
+      c -= 'A' - 10;
+    else
+      return -1;
+    *v = *v << 4 | c;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  uint mask;
+  int pid;
+
+  if(argc < 2 || argc > 3 || (argc == 3 && atoh(argv[2], &mask) < 0)) { // 입력 방식이 잘못됐을 경우 에러처리
+    printf(2, "usage : taskset <pid> [mask]\n");
+    exit();
+  }
+  pid = atoi(argv[1]);
+
+  if(argc == 3 && sched_setaffinity(pid, mask) < 0) {
+    printf(2, "sched_setaffinity error\n");
+    exit();
+  }
+
+  if(sched_getaffinity(pid, &mask) < 0) {
+    printf(2, "sched_getaffinity error\n");
+    exit();
+  }
+  printf(1, "pid %d: cpu mask 0x%x\n", pid, mask);
+
+  exit();
+}
@@ -0,0 +1,105 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "mmu.h"
+
+// clone/join 과 uthread 라이브러리를 확인하는 프로그램.
+// 스레드들이 같은 전역 변수를 lock 으로 함께 고치는지, 한 스레드가 sbrk 로 늘린 메모리가
+// 다른 스레드에도 보이는지, join 이 끝난 스레드를 하나씩 거두고 더 없으면 -1 인지,
+// 주소 공간을 함께 쓰는 스레드가 있는 동안 exec 가 -1 을 돌려주는지 본다.
+
+#define NTHREAD 4
+#define NITER   1000
+
+static lock_t lk;
+static int counter;
+static char *grown;          // 스레드가 sbrk 로 늘린 메모리
+static volatile int started; // exec 검사용 스레드가 실행을 시작했으면 1
+static volatile int done;    // exec 검사용 스레드에게 끝내라고 알린다
+
+static void
+fail(char *msg)
+{
+  printf(2, "threadtest: FAIL %s\n", msg);
+  exit();
+}
+
+static void
+add(void *arg1, void *arg2)
+{
+  int i, n = (int)arg1;
+
+  for(i = 0; i < n; i++){
+    lock_acquire(&lk);
+    counter++;
+    lock_release(&lk);
+  }
+  exit();
+}
+
+static void
+grow(void *arg1, void *arg2)
+{
+  char *p;
+
+  if((p = sbrk(PGSIZE)) == (char*)-1)
+    exit();
+  p[0] = 'x';
+  p[PGSIZE-1] = 'y';
+  grown = p;
+  exit();
+}
+
+static void
+spin(void *arg1, void *arg2)
+{
+  started = 1;
+  while(!done)
+    ;
+  exit();
+}
+
+int main(int argc, char **argv) {
+  char *args[] = { "echo", "threadtest: exec not refused", 0 };
+  int pids[NTHREAD];
+  void *stack;
+  int i, j, pid;
+
+  lock_init(&lk);
+  for(i = 0; i < NTHREAD; i++)
+    if((pids[i] = thread_create(add, (void*)NITER, 0)) < 0)
+      fail("thread_create");
+  for(i = 0; i < NTHREAD; i++){
+    if((pid = thread_join()) < 0)
+      fail("thread_join");
+    for(j = 0; j < NTHREAD && pids[j] != pid; j++)
+      ;
+    if(j == NTHREAD)
+      fail("join pid");
+    pids[j] = -1; // 같은 스레드를 두 번 거두지 않는다
+  }
+  if(join(&stack) != -1)
+    fail("join without threads");
+  if(counter != NTHREAD * NITER)
+    fail("counter");
+
+  // 스레드가 늘린 주소 공간이 만든 프로세스에도 보인다
+  if(thread_create(grow, 0, 0) < 0 || thread_join() < 0)
+    fail("grow thread");
+  if(grown == 0 || grown[0] != 'x' || grown[PGSIZE-1] != 'y')
+    fail("shared sbrk");
+
+  // 주소 공간을 함께 쓰는 스레드가 살아 있는 동안에는 exec 할 수 없다
+  if(thread_create(spin, 0, 0) < 0)
+    fail("spin thread");
+  while(!started)
+    ;
+  if(exec("echo", args) != -1)
+    fail("exec from threads");
+  done = 1;
+  if(thread_join() < 0)
+    fail("spin join");
+
+  printf(1, "threadtest: ok\n");
+  exit();
+}
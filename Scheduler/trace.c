@@ -0,0 +1,121 @@
+// Scheduler event trace.
+//
+// 각 CPU 는 고정 크기의 원형 버퍼를 하나씩 가진다. 이벤트를 기록하는 쪽은
+// 인터럽트를 끈 채 자신의 CPU 버퍼에만 쓰므로 lock 이 필요 없다.
+// /schedtrace 장치를 읽으면 각 CPU 버퍼에서 아직 읽지 않은 이벤트를
+// 복사해 가고, 복사하는 동안 덮어쓰였을 수 있는 이벤트는 버린다.
+// 읽는 쪽은 사용자 메모리에 직접 복사하다 폴트를 낼 수 있으므로 sleeplock 으로 줄을 세운다.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "sched.h"
+
+#define NTRACE 256  // CPU 당 보관하는 이벤트 수
+
+struct tracebuf {
+  struct schedevent ev[NTRACE];
+  volatile uint head;  // 다음에 기록할 위치 (계속 증가만 한다)
+  uint tail;           // 다음에 읽을 위치 (읽는 쪽만 바꾼다)
+};
+
+static struct tracebuf tracebuf[NCPU];
+static struct sleeplock tracelock;  // 읽는 쪽끼리만 잡는다
+
+// 현재 CPU 의 버퍼에 이벤트를 하나 기록한다.
+void
+schedtrace(int type, struct proc *p, int slice)
+{
+  struct tracebuf *tb;
+  struct schedevent *e;
+  int id;
+
+  pushcli();
+  id = cpuid();
+  tb = &tracebuf[id];
+  e = &tb->ev[tb->head % NTRACE];
+  e->tsc = rdtsc();
+  e->tick = ticks;
+  e->type = type;
+  e->cpu = id;
+  e->level = p->q_level;
+  e->pid = p->pid;
+  e->slice = slice;
+  e->burst = p->cpu_burst;
+  e->limit = p->end_time;
+  // 이벤트 내용이 보인 다음에 head 가 움직이도록 한다
+  __sync_synchronize();
+  tb->head++;
+  popcli();
+}
+
+// 아직 읽지 않은 이벤트를 dst 에 struct schedevent 단위로 복사한다.
+// 읽을 이벤트가 없으면 0 을 돌려준다.
+static int
+schedtraceread(struct inode *ip, char *dst, int n)
+{
+  struct tracebuf *tb;
+  uint h, start, k;
+  int i, cnt, first, lost, max;
+  int sz = sizeof(struct schedevent);
+
+  max = n / sz;
+  cnt = 0;
+  if(pagein((uint)dst, max*sz, 1) < 0)  // 쓸 수 없는 버퍼면 아무것도 읽어 가지 않는다
+    return -1;
+  acquiresleep(&tracelock);
+  for(i = 0; i < ncpu && cnt < max; i++){
+    tb = &tracebuf[i];
+    h = tb->head;
+    __sync_synchronize();
+    start = tb->tail;
+    if(h - start > NTRACE)
+      start = h - NTRACE;  // 읽기 전에 덮어쓰인 이벤트는 건너뛴다
+
+    first = cnt;
+    for(k = start; k != h && cnt < max; k++, cnt++)
+      if(copyuser(dst + cnt*sz, &tb->ev[k % NTRACE], sz) < 0)
+        goto bad;
+
+    // 복사하는 동안 기록하는 쪽이 따라잡았으면 앞쪽 이벤트를 버린다
+    __sync_synchronize();
+    h = tb->head;
+    if(h - start >= NTRACE){
+      lost = h - NTRACE + 1 - start;
+      if(lost > cnt - first)
+        lost = cnt - first;
+      if(copyuser(dst + first*sz, dst + (first+lost)*sz, (cnt-first-lost)*sz) < 0)
+        goto bad;
+      cnt -= lost;
+    }
+    tb->tail = k;
+  }
+  releasesleep(&tracelock);
+  return cnt * sz;
+
+bad:
+  // 복사하는 사이에 다른 스레드가 dst 를 없앴다
+  releasesleep(&tracelock);
+  return -1;
+}
+
+static int
+schedtracewrite(struct inode *ip, char *buf, int n)
+{
+  return -1;
+}
+
+void
+schedtraceinit(void)
+{
+  initsleeplock(&tracelock, "schedtrace");
+  devsw[SCHEDTRACE].read = schedtraceread;
+  devsw[SCHEDTRACE].write = schedtracewrite;
+}
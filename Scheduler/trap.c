@@ -0,0 +1,138 @@
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "x86.h"
+#include "traps.h"
+#include "spinlock.h"
+#include "mcslock.h"
+
+// Interrupt descriptor table (shared by all CPUs).
+struct gatedesc idt[256];
+extern uint vectors[];  // in vectors.S: array of 256 entry pointers
+struct mcslock tickslock;  // sleep 하는 프로세스가 모두 잡으므로 MCS lock 이다
+uint ticks;
+
+void
+tvinit(void)
+{
+  int i;
+
+  for(i = 0; i < 256; i++)
+    SETGATE(idt[i], 0, SEG_KCODE<<3, vectors[i], 0);
+  SETGATE(idt[T_SYSCALL], 1, SEG_KCODE<<3, vectors[T_SYSCALL], DPL_USER);
+
+  mcsinit(&tickslock, "time");
+}
+
+void
+idtinit(void)
+{
+  lidt(idt, sizeof(idt));
+}
+
+//PAGEBREAK: 41
+void
+trap(struct trapframe *tf)
+{
+  if(tf->trapno == T_SYSCALL){
+    if(myproc()->killed)
+      exit();
+    myproc()->tf = tf;
+    syscall();
+    if(myproc()->killed)
+      exit();
+    return;
+  }
+
+  switch(tf->trapno){
+  case T_IRQ0 + IRQ_TIMER:
+    if(cpuid() == 0){
+      mcsacquire(&tickslock);
+      ticks++;
+      wakeup(&ticks);
+      mcsrelease(&tickslock);
+    }
+    schedtick(); // 모든 CPU 에서 실행 중인 프로세스의 CPU 사용 시간을 센다
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_IDE:
+    ideintr();
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_IDE+1:
+    // Bochs generates spurious IDE1 interrupts.
+    break;
+  case T_IRQ0 + IRQ_KBD:
+    kbdintr();
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_COM1:
+    uartintr();
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_TLB:
+    // 다른 CPU 가 이 CPU 에서 쓰고 있는 주소 공간의 페이지를 뺐다 (tlbshootdown).
+    tlbintr();
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_WAKEUP:
+    // 다른 CPU 가 실행 큐에 일을 넣고 깨웠다. hlt 에서 빠져나오기만 하면
+    // 스케줄러가 다시 큐를 확인한다.
+    lapiceoi();
+    break;
+  case T_IRQ0 + 7:
+  case T_IRQ0 + IRQ_SPURIOUS:
+    cprintf("cpu%d: spurious interrupt at %x:%x\n",
+            cpuid(), tf->cs, tf->eip);
+    lapiceoi();
+    break;
+  case T_PGFLT:
+    // 아직 할당하지 않은 sbrk 나 mmap 페이지, fork 뒤에 함께 쓰는 쓰기 시 복사 페이지를 건드렸다.
+    // 사용자 코드뿐 아니라 사용자 메모리를 직접 읽고 쓰는 시스템 호출에서도 나므로 (CR0_WP)
+    // 모드와 상관없이 페이지를 채워 주고 다시 실행한다.
+    // 그런 페이지가 아니면 아래의 다른 trap 과 똑같이 처리한다.
+    if(myproc() && pagefault(rcr2(), tf->err) == 0)
+      break;
+    // 시스템 호출이 검사한 사용자 버퍼를 그 사이에 다른 스레드가 없앴으면 panic 하지 않고
+    // 복사하던 copyuser 가 -1 을 돌려주게 한다.
+    if(myproc() && (tf->cs&3) == 0 && myproc()->onfault){
+      tf->eip = myproc()->onfault;
+      break;
+    }
+    // fall through
+
+  //PAGEBREAK: 13
+  default:
+    if(myproc() == 0 || (tf->cs&3) == 0){
+      // In kernel, it must be our mistake.
+      cprintf("unexpected trap %d from cpu %d eip %x (cr2=0x%x)\n",
+              tf->trapno, cpuid(), tf->eip, rcr2());
+      panic("trap");
+    }
+    // In user space, assume process misbehaved.
+    cprintf("pid %d %s: trap %d err %d on cpu %d "
+            "eip 0x%x addr 0x%x--kill proc\n",
+            myproc()->pid, myproc()->name, tf->trapno,
+            tf->err, cpuid(), tf->eip, rcr2());
+    myproc()->killed = 1;
+  }
+
+  // Force process exit if it has been killed and is in user space.
+  // (If it is still executing in the kernel, let it keep running
+  // until it gets to the regular system call return.)
+  if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
+    exit();
+
+  // Force process to give up CPU on clock tick.
+  // If interrupts were on while locks held, would need to check nlock.
+  if(myproc() && myproc()->state == RUNNING &&
+     tf->trapno == T_IRQ0+IRQ_TIMER)
+    yield();
+
+  // Check if the process has been killed since we yielded
+  if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
+    exit();
+}
@@ -2,6 +2,7 @@ typedef unsigned int   uint;
 typedef unsigned short ushort;
 typedef unsigned char  uchar;
 typedef uint pde_t;
+typedef unsigned long long uint64;
 
 #ifndef _STDIO_H 
 typedef int off_t;  // off_t 타입 정의
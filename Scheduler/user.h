@@ -1,5 +1,12 @@
 struct stat;
 struct rtcdate;
+struct schedconfig;
+struct procinfo;
+struct cpustat;
+struct schedattr;
+struct lockstat;
+struct spawnfa;
+struct spawnattr;
 
 // system calls
 int fork(void);
@@ -25,6 +32,20 @@ int sleep(int);
 int uptime(void);
 off_t lseek(int fd, off_t offset, int whence); // 시스템 콜에 lseek 함수 정의, 추가
 int set_proc_info(int q_level, int cpu_burst, int cpu_wait_time, int io_wait_time, int end_time);
+int sched_setconfig(struct schedconfig*);
+int sched_getconfig(struct schedconfig*);
+int getprocinfo(struct procinfo*, int);
+int getcpustat(struct cpustat*, int);
+int sched_setattr(int, struct schedattr*);
+int sched_getattr(int, struct schedattr*);
+int sched_setaffinity(int, uint);
+int sched_getaffinity(int, uint*);
+int clone(void(*)(void*, void*), void*, void*, void*);
+int join(void**);
+int getlockstat(struct lockstat*, int);
+int spawn(char*, char**, struct spawnfa*, struct spawnattr*);
+void* mmap(void*, uint, int, int, int, uint);
+int munmap(void*, uint);
 
 
 // ulib.c
@@ -40,3 +61,14 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+
+// uthread.c
+typedef struct {
+  volatile uint ticket; // 다음에 나눠 줄 번호표
+  volatile uint turn;   // 지금 lock 을 가질 차례인 번호표
+} lock_t;
+int thread_create(void(*)(void*, void*), void*, void*);
+int thread_join(void);
+void lock_init(lock_t*);
+void lock_acquire(lock_t*);
+void lock_release(lock_t*);
@@ -0,0 +1,78 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "mmu.h"
+
+// clone/join 위에 얹은 작은 사용자 스레드 라이브러리와 spinlock.
+// 스레드는 만든 프로세스와 주소 공간, 열린 파일, 작업 디렉토리를 함께 쓰고
+// 스케줄러에게는 따로 스케줄되는 프로세스 하나로 보인다.
+
+// malloc/free 는 스레드에 안전하지 않으므로 스택을 할당하고 해제할 때 잡는다.
+static lock_t stacklock;
+
+// 스레드를 만들어 start_routine(arg1, arg2) 을 실행하게 하고 pid 를 돌려준다.
+// clone 은 페이지 경계에 맞춘 한 페이지의 스택을 원하므로 두 페이지를 할당해
+// 그 안에서 경계에 맞춘 페이지를 쓰고, 원래 주소는 그 바로 아래에 적어 둔다.
+// malloc 은 8 바이트 단위로 주소를 주므로 4 바이트를 비워도 스택 페이지는 할당 범위 안에 있다.
+int
+thread_create(void (*start_routine)(void*, void*), void *arg1, void *arg2)
+{
+  char *mem;
+  uint stack;
+  int pid;
+
+  lock_acquire(&stacklock);
+  mem = malloc(2*PGSIZE);
+  lock_release(&stacklock);
+  if(mem == 0)
+    return -1;
+  stack = PGROUNDUP((uint)mem + sizeof(char*));
+  ((char**)stack)[-1] = mem;
+
+  if((pid = clone(start_routine, arg1, arg2, (void*)stack)) < 0){
+    lock_acquire(&stacklock);
+    free(mem);
+    lock_release(&stacklock);
+  }
+  return pid;
+}
+
+// 자식 스레드 하나가 끝나기를 기다려 스택을 해제하고 pid 를 돌려준다.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) < 0)
+    return -1;
+  lock_acquire(&stacklock);
+  free(((char**)stack)[-1]);
+  lock_release(&stacklock);
+  return pid;
+}
+
+// 번호표 (ticket) lock. 기다리는 스레드는 번호표를 받은 순서대로 lock 을 얻는다.
+void
+lock_init(lock_t *lk)
+{
+  lk->ticket = 0;
+  lk->turn = 0;
+}
+
+void
+lock_acquire(lock_t *lk)
+{
+  uint my = __sync_fetch_and_add(&lk->ticket, 1);
+
+  while(lk->turn != my)
+    ;
+  __sync_synchronize(); // lock 을 얻은 뒤의 메모리 접근이 앞으로 당겨지지 않게 한다
+}
+
+void
+lock_release(lock_t *lk)
+{
+  __sync_synchronize(); // lock 을 가진 동안의 메모리 접근이 모두 끝난 뒤에 넘긴다
+  lk->turn++;
+}
@@ -0,0 +1,623 @@
+#include "param.h"
+#include "types.h"
+#include "defs.h"
+#include "x86.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "elf.h"
+
+// 쓰기 시 복사 페이지 표시. 하드웨어가 쓰지 않는 PTE 의 AVL 비트를 쓴다.
+// 이 표시가 있는 페이지는 PTE_W 를 끄고 다른 페이지 테이블과 함께 쓰며,
+// 쓰려고 하면 페이지 폴트가 나서 cowfault 가 자기 복사본을 만든다.
+#define PTE_COW         0x200
+
+#ifndef PTE_D
+#define PTE_D           0x040   // Dirty (페이지에 쓰면 하드웨어가 켠다)
+#endif
+
+extern char data[];  // defined by kernel.ld
+pde_t *kpgdir;  // for use in scheduler()
+
+// Set up CPU's kernel segment descriptors.
+// Run once on entry on each CPU.
+void
+seginit(void)
+{
+  struct cpu *c;
+
+  // Map "logical" addresses to virtual addresses using identity map.
+  // Cannot share a CODE descriptor for both kernel and user
+  // because it would have to have DPL_USR, but the CPU forbids
+  // an interrupt from CPL=0 to DPL=3.
+  c = &cpus[cpuid()];
+  c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
+  c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
+  c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
+  c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+  lgdt(c->gdt, sizeof(c->gdt));
+}
+
+// Return the address of the PTE in page table pgdir
+// that corresponds to virtual address va.  If alloc!=0,
+// create any required page table pages.
+static pte_t *
+walkpgdir(pde_t *pgdir, const void *va, int alloc)
+{
+  pde_t *pde;
+  pte_t *pgtab;
+
+  pde = &pgdir[PDX(va)];
+  if(*pde & PTE_P){
+    pgtab = (pte_t*)P2V(PTE_ADDR(*pde));
+  } else {
+    if(!alloc || (pgtab = (pte_t*)kalloc()) == 0)
+      return 0;
+    // Make sure all those PTE_P bits are zero.
+    memset(pgtab, 0, PGSIZE);
+    // The permissions here are overly generous, but they can
+    // be further restricted by the permissions in the page table
+    // entries, if necessary.
+    *pde = V2P(pgtab) | PTE_P | PTE_W | PTE_U;
+  }
+  return &pgtab[PTX(va)];
+}
+
+// Create PTEs for virtual addresses starting at va that refer to
+// physical addresses starting at pa. va and size might not
+// be page-aligned.
+static int
+mappages(pde_t *pgdir, void *va, uint size, uint pa, int perm)
+{
+  char *a, *last;
+  pte_t *pte;
+
+  a = (char*)PGROUNDDOWN((uint)va);
+  last = (char*)PGROUNDDOWN(((uint)va) + size - 1);
+  for(;;){
+    if((pte = walkpgdir(pgdir, a, 1)) == 0)
+      return -1;
+    if(*pte & PTE_P)
+      panic("remap");
+    *pte = pa | perm | PTE_P;
+    if(a == last)
+      break;
+    a += PGSIZE;
+    pa += PGSIZE;
+  }
+  return 0;
+}
+
+// pgdir 이 이 CPU 가 쓰고 있는 페이지 테이블이면 바꾼 PTE 가 보이도록 TLB 를 비운다.
+// 쓰기 시 복사 페이지는 스레드가 하나뿐인 주소 공간에만 있으므로 (cowbreak)
+// 다른 CPU 의 TLB 는 신경 쓰지 않아도 된다.
+static void
+flushtlb(pde_t *pgdir)
+{
+  struct proc *p = myproc();
+
+  if(p && p->pgdir == pgdir)
+    lcr3(V2P(pgdir));
+}
+
+// There is one page table per process, plus one that's used when
+// a CPU is not running any process (kpgdir). The kernel uses the
+// current process's page table during system calls and interrupts;
+// page protection bits prevent user code from using the kernel's
+// mappings.
+//
+// setupkvm() and exec() set up every page table like this:
+//
+//   0..KERNBASE: user memory (text+data+stack+heap), mapped to
+//                phys memory allocated by the kernel
+//   KERNBASE..KERNBASE+EXTMEM: mapped to 0..EXTMEM (for I/O space)
+//   KERNBASE+EXTMEM..data: mapped to EXTMEM..V2P(data)
+//                for the kernel's instructions and r/o data
+//   data..KERNBASE+PHYSTOP: mapped to V2P(data)..PHYSTOP,
+//                                  rw data + free physical memory
+//   0xfe000000..0: mapped direct (devices such as ioapic)
+//
+// The kernel allocates physical memory for its heap and for user memory
+// between V2P(end) and the end of physical memory (PHYSTOP)
+// (directly addressable from end..P2V(PHYSTOP)).
+
+// This table defines the kernel's mappings, which are present in
+// every process's page table.
+static struct kmap {
+  void *virt;
+  uint phys_start;
+  uint phys_end;
+  int perm;
+} kmap[] = {
+ { (void*)KERNBASE, 0,             EXTMEM,    PTE_W}, // I/O space
+ { (void*)KERNLINK, V2P(KERNLINK), V2P(data), 0},     // kern text+rodata
+ { (void*)data,     V2P(data),     PHYSTOP,   PTE_W}, // kern data+memory
+ { (void*)DEVSPACE, DEVSPACE,      0,         PTE_W}, // more devices
+};
+
+// Set up kernel part of a page table.
+pde_t*
+setupkvm(void)
+{
+  pde_t *pgdir;
+  struct kmap *k;
+
+  if((pgdir = (pde_t*)kalloc()) == 0)
+    return 0;
+  memset(pgdir, 0, PGSIZE);
+  if (P2V(PHYSTOP) > (void*)DEVSPACE)
+    panic("PHYSTOP too high");
+  for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
+    if(mappages(pgdir, k->virt, k->phys_end - k->phys_start,
+                (uint)k->phys_start, k->perm) < 0) {
+      freevm(pgdir);
+      return 0;
+    }
+  return pgdir;
+}
+
+// Allocate one page table for the machine for the kernel address
+// space for scheduler processes.
+void
+kvmalloc(void)
+{
+  kpgdir = setupkvm();
+  switchkvm();
+}
+
+// Switch h/w page table register to the kernel-only page table,
+// for when no process is running.
+void
+switchkvm(void)
+{
+  lcr3(V2P(kpgdir));   // switch to the kernel page table
+}
+
+// Switch TSS and h/w page table to correspond to process p.
+void
+switchuvm(struct proc *p)
+{
+  if(p == 0)
+    panic("switchuvm: no process");
+  if(p->kstack == 0)
+    panic("switchuvm: no kstack");
+  if(p->pgdir == 0)
+    panic("switchuvm: no pgdir");
+
+  pushcli();
+  mycpu()->gdt[SEG_TSS] = SEG16(STS_T32A, &mycpu()->ts,
+                                sizeof(mycpu()->ts)-1, 0);
+  mycpu()->gdt[SEG_TSS].s = 0;
+  mycpu()->ts.ss0 = SEG_KDATA << 3;
+  mycpu()->ts.esp0 = (uint)p->kstack + KSTACKSIZE;
+  // setting IOPL=0 in eflags *and* iomb beyond the tss segment limit
+  // forbids I/O instructions (e.g., inb and outb) from user space
+  mycpu()->ts.iomb = (ushort) 0xFFFF;
+  ltr(SEG_TSS << 3);
+  lcr3(V2P(p->pgdir));  // switch to process's address space
+  popcli();
+}
+
+// Load the initcode into address 0 of pgdir.
+// sz must be less than a page.
+void
+inituvm(pde_t *pgdir, char *init, uint sz)
+{
+  char *mem;
+
+  if(sz >= PGSIZE)
+    panic("inituvm: more than a page");
+  mem = kalloc();
+  memset(mem, 0, PGSIZE);
+  mappages(pgdir, 0, PGSIZE, V2P(mem), PTE_W|PTE_U);
+  memmove(mem, init, sz);
+}
+
+// Load a program segment into pgdir.  addr must be page-aligned
+// and the pages from addr to addr+sz must already be mapped.
+int
+loaduvm(pde_t *pgdir, char *addr, struct inode *ip, uint offset, uint sz)
+{
+  uint i, pa, n;
+  pte_t *pte;
+
+  if((uint) addr % PGSIZE != 0)
+    panic("loaduvm: addr must be page aligned");
+  for(i = 0; i < sz; i += PGSIZE){
+    if((pte = walkpgdir(pgdir, addr+i, 0)) == 0)
+      panic("loaduvm: address should exist");
+    pa = PTE_ADDR(*pte);
+    if(sz - i < PGSIZE)
+      n = sz - i;
+    else
+      n = PGSIZE;
+    if(readi(ip, P2V(pa), offset+i, n) != n)
+      return -1;
+  }
+  return 0;
+}
+
+// Allocate page tables and physical memory to grow process from oldsz to
+// newsz, which need not be page aligned.  Returns new size or 0 on error.
+int
+allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
+{
+  char *mem;
+  uint a;
+
+  if(newsz >= KERNBASE)
+    return 0;
+  if(newsz < oldsz)
+    return oldsz;
+
+  a = PGROUNDUP(oldsz);
+  for(; a < newsz; a += PGSIZE){
+    mem = kalloc();
+    if(mem == 0){
+      cprintf("allocuvm out of memory\n");
+      deallocuvm(pgdir, newsz, oldsz);
+      return 0;
+    }
+    memset(mem, 0, PGSIZE);
+    if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+      cprintf("allocuvm out of memory (2)\n");
+      deallocuvm(pgdir, newsz, oldsz);
+      kfree(mem);
+      return 0;
+    }
+  }
+  return newsz;
+}
+
+// Deallocate user pages to bring the process size from oldsz to
+// newsz.  oldsz and newsz need not be page-aligned, nor does newsz
+// need to be less than oldsz.  oldsz can be larger than the actual
+// process size.  Returns the new process size.
+// 함께 쓰는 페이지는 kfree 가 참조 수만 줄인다.
+int
+deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
+{
+  pte_t *pte;
+  uint a, pa;
+
+  if(newsz >= oldsz)
+    return oldsz;
+
+  a = PGROUNDUP(newsz);
+  for(; a  < oldsz; a += PGSIZE){
+    pte = walkpgdir(pgdir, (char*)a, 0);
+    if(!pte)
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+    else if((*pte & PTE_P) != 0){
+      pa = PTE_ADDR(*pte);
+      if(pa == 0)
+        panic("kfree");
+      char *v = P2V(pa);
+      kfree(v);
+      *pte = 0;
+    }
+  }
+  return newsz;
+}
+
+// Free a page table and all the physical memory pages
+// in the user part.
+void
+freevm(pde_t *pgdir)
+{
+  uint i;
+
+  if(pgdir == 0)
+    panic("freevm: no pgdir");
+  deallocuvm(pgdir, KERNBASE, 0);
+  for(i = 0; i < NPDENTRIES; i++){
+    if(pgdir[i] & PTE_P){
+      char * v = P2V(PTE_ADDR(pgdir[i]));
+      kfree(v);
+    }
+  }
+  kfree((char*)pgdir);
+}
+
+// Clear PTE_U on a page. Used to create an inaccessible
+// page beneath the user stack.
+void
+clearpteu(pde_t *pgdir, char *uva)
+{
+  pte_t *pte;
+
+  pte = walkpgdir(pgdir, uva, 0);
+  if(pte == 0)
+    panic("clearpteu");
+  *pte &= ~PTE_U;
+}
+
+// Given a parent process's page table, create a copy
+// of it for a child.
+// 페이지를 모두 바로 복사한다. 스레드가 여럿인 프로세스의 fork 가 쓴다.
+pde_t*
+copyuvm(pde_t *pgdir, uint sz)
+{
+  pde_t *d;
+  pte_t *pte;
+  uint pa, i, flags;
+  char *mem;
+
+  if((d = setupkvm()) == 0)
+    return 0;
+  for(i = 0; i < sz; i += PGSIZE){
+    // sbrk 로 늘렸지만 아직 쓰지 않은 페이지는 자식도 처음 쓸 때 할당한다
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0 || !(*pte & PTE_P))
+      continue;
+    pa = PTE_ADDR(*pte);
+    flags = PTE_FLAGS(*pte);
+    if((mem = kalloc()) == 0)
+      goto bad;
+    memmove(mem, (char*)P2V(pa), PGSIZE);
+    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0) {
+      kfree(mem);
+      goto bad;
+    }
+  }
+  return d;
+
+bad:
+  freevm(d);
+  return 0;
+}
+
+// 자식의 페이지 테이블을 만들되 사용자 페이지는 복사하지 않고 부모와 함께 쓴다.
+// 쓸 수 있던 페이지는 부모와 자식 모두 읽기 전용 + PTE_COW 로 두어, 먼저 쓰는 쪽이
+// 페이지 폴트에서 자기 복사본을 만든다. 그래서 fork 는 부모의 크기만큼 메모리를
+// 복사하지 않고, exec 로 바로 주소 공간을 버리는 자식은 아무것도 복사하지 않는다.
+// 스택 아래의 보호 페이지처럼 PTE_U 가 없는 페이지는 커널이 쓰다 폴트를 낼 수 있으므로
+// 바로 복사한다.
+pde_t*
+cowuvm(pde_t *pgdir, uint sz)
+{
+  pde_t *d;
+  pte_t *pte;
+  uint pa, i, flags;
+  char *mem;
+
+  if((d = setupkvm()) == 0)
+    return 0;
+  for(i = 0; i < sz; i += PGSIZE){
+    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0 || !(*pte & PTE_P))
+      continue;
+    if(!(*pte & PTE_U)){
+      pa = PTE_ADDR(*pte);
+      flags = PTE_FLAGS(*pte);
+      if((mem = kalloc()) == 0)
+        goto bad;
+      memmove(mem, (char*)P2V(pa), PGSIZE);
+      if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0) {
+        kfree(mem);
+        goto bad;
+      }
+      continue;
+    }
+    if(*pte & PTE_W)
+      *pte = (*pte & ~PTE_W) | PTE_COW;
+    pa = PTE_ADDR(*pte);
+    flags = PTE_FLAGS(*pte);
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
+      goto bad;
+    kincref(P2V(pa));
+  }
+  flushtlb(pgdir);
+  return d;
+
+bad:
+  // 부모에 남은 PTE_COW 는 참조 수가 1 로 돌아오므로 첫 쓰기에서 그대로 풀린다
+  flushtlb(pgdir);
+  freevm(d);
+  return 0;
+}
+
+// sbrk 는 주소 범위 (sz) 만 늘리고 페이지는 할당하지 않는다. sz 아래에서 아직 페이지가 없는
+// va 에 0 으로 채운 페이지를 할당한다. 없던 페이지를 채우는 것이므로 TLB 는 비우지 않아도 된다.
+// 이미 페이지가 있으면 0, sz 밖이거나 메모리가 모자라면 -1.
+int
+lazyfault(pde_t *pgdir, uint va, uint sz)
+{
+  pte_t *pte;
+  char *mem;
+
+  if(va >= sz || va >= KERNBASE)
+    return -1;
+  va = PGROUNDDOWN(va);
+  if((pte = walkpgdir(pgdir, (char*)va, 0)) != 0 && (*pte & PTE_P))
+    return 0;
+  if((mem = kalloc()) == 0)
+    return -1;
+  memset(mem, 0, PGSIZE);
+  if(mappages(pgdir, (char*)va, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
+    kfree(mem);
+    return -1;
+  }
+  return 0;
+}
+
+// 페이지 폴트가 난 va 가 쓰기 시 복사 페이지면 쓸 수 있게 만들고 0 을 돌려준다.
+// 다른 페이지 테이블과 아직 함께 쓰고 있으면 복사본을 만들어 바꾸고, 이제 혼자
+// 쓰고 있으면 복사 없이 쓰기만 허락한다. 이미 쓸 수 있는 페이지도 0 이다.
+// 사용자 페이지가 아니거나 쓰기 시 복사 페이지가 아니거나 메모리가 모자라면 -1.
+int
+cowfault(pde_t *pgdir, uint va)
+{
+  pte_t *pte;
+  uint pa, flags;
+  char *mem;
+
+  if(va >= KERNBASE || (pte = walkpgdir(pgdir, (char*)va, 0)) == 0)
+    return -1;
+  if((*pte & (PTE_P|PTE_U)) != (PTE_P|PTE_U))
+    return -1;
+  if(*pte & PTE_W)
+    return 0;
+  if(!(*pte & PTE_COW))
+    return -1;
+
+  pa = PTE_ADDR(*pte);
+  flags = (PTE_FLAGS(*pte) | PTE_W) & ~PTE_COW;
+  if(krefcount(P2V(pa)) > 1){
+    if((mem = kalloc()) == 0)
+      return -1;
+    memmove(mem, (char*)P2V(pa), PGSIZE);
+    *pte = V2P(mem) | flags;
+    kfree(P2V(pa));
+  } else
+    *pte = pa | flags;
+  flushtlb(pgdir);
+  return 0;
+}
+
+// pgdir 의 쓰기 시 복사 페이지를 모두 자기 것으로 만든다. 주소 공간을 스레드와 함께
+// 쓰기 전에 부른다. cowfault 는 이 CPU 의 TLB 만 비우므로 스레드가 여럿인 주소 공간에는
+// 쓰기 시 복사 페이지를 두지 않는다.
+int
+cowbreak(pde_t *pgdir, uint sz)
+{
+  pte_t *pte;
+  uint va;
+
+  for(va = 0; va < sz; va += PGSIZE){
+    if((pte = walkpgdir(pgdir, (char*)va, 0)) == 0)
+      continue;
+    if((*pte & PTE_COW) && (*pte & PTE_U) && cowfault(pgdir, va) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+// [start, end) 의 사용자 페이지를 페이지 테이블에서 빼되 해제하지는 않는다. 다른 CPU 에서
+// 도는 스레드의 TLB 에 남았을 수 있으므로, tlbshootdown 으로 비운 뒤 uvmreap 으로 해제한다.
+// 뺀 PTE 는 PTE_P 만 끄고 주소를 남겨 두므로 (xv6 에서 PTE_P 가 없는 PTE 는 늘 0 이다)
+// 그 사이에 이 범위를 다시 채우지 않게 부른 쪽이 막아야 한다.
+void
+uvmzap(pde_t *pgdir, uint start, uint end)
+{
+  pte_t *pte;
+  uint a;
+
+  for(a = PGROUNDUP(start); a < end; a += PGSIZE){
+    if((pte = walkpgdir(pgdir, (char*)a, 0)) == 0)
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+    else if(*pte & PTE_P)
+      *pte &= ~PTE_P;
+  }
+  flushtlb(pgdir);
+}
+
+// uvmzap 으로 뺀 [start, end) 의 페이지를 해제한다.
+void
+uvmreap(pde_t *pgdir, uint start, uint end)
+{
+  pte_t *pte;
+  uint a;
+
+  for(a = PGROUNDUP(start); a < end; a += PGSIZE){
+    if((pte = walkpgdir(pgdir, (char*)a, 0)) == 0)
+      a = PGADDR(PDX(a) + 1, 0, 0) - PGSIZE;
+    else if(*pte && !(*pte & PTE_P)){
+      kfree(P2V(PTE_ADDR(*pte)));
+      *pte = 0;
+    }
+  }
+}
+
+// pgdir 에 있는 va 페이지의 커널 주소. 페이지가 없으면 0.
+// dirty 가 0 이 아니면 페이지에 쓴 적이 있는지 (PTE_D) 를 넣는다 (mmap 의 write back).
+char*
+uvmpage(pde_t *pgdir, uint va, int *dirty)
+{
+  pte_t *pte;
+
+  if((pte = walkpgdir(pgdir, (char*)va, 0)) == 0 || !(*pte & PTE_P))
+    return 0;
+  if(dirty)
+    *dirty = (*pte & PTE_D) != 0;
+  return (char*)P2V(PTE_ADDR(*pte));
+}
+
+// va 에 페이지 mem 을 perm 권한으로 넣는다 (mmap). 없던 페이지를 넣으므로 TLB 는 비우지 않는다.
+int
+uvmmap(pde_t *pgdir, uint va, char *mem, int perm)
+{
+  return mappages(pgdir, (char*)va, PGSIZE, V2P(mem), perm);
+}
+
+//PAGEBREAK!
+// Map user virtual address to kernel address.
+char*
+uva2ka(pde_t *pgdir, char *uva)
+{
+  pte_t *pte;
+
+  pte = walkpgdir(pgdir, uva, 0);
+  if(pte == 0 || (*pte & PTE_P) == 0)
+    return 0;
+  if((*pte & PTE_U) == 0)
+    return 0;
+  return (char*)P2V(PTE_ADDR(*pte));
+}
+
+// Copy len bytes from p to user address va in page table pgdir.
+// Most useful when pgdir is not the current page table.
+// uva2ka ensures this only works for PTE_U pages.
+// 커널 주소로 쓰므로 폴트가 나지 않는다. 쓰기 시 복사 페이지는 먼저 복사해 둔다.
+int
+copyout(pde_t *pgdir, uint va, void *p, uint len)
+{
+  char *buf, *pa0;
+  uint n, va0;
+
+  buf = (char*)p;
+  while(len > 0){
+    va0 = (uint)PGROUNDDOWN(va);
+    if(cowfault(pgdir, va0) < 0)
+      return -1;
+    pa0 = uva2ka(pgdir, (char*)va0);
+    if(pa0 == 0)
+      return -1;
+    n = PGSIZE - (va - va0);
+    if(n > len)
+      n = len;
+    memmove(pa0 + (va - va0), buf, n);
+    len -= n;
+    buf += n;
+    va = va0 + PGSIZE;
+  }
+  return 0;
+}
+
+// 현재 프로세스의 사용자 메모리와 커널 사이에서 n 바이트를 복사한다 (dst, src 중 하나가 사용자 주소).
+// 시스템 호출이 주소를 검사한 뒤에 다른 스레드가 sbrk 나 munmap 으로 그 페이지를 없앴으면
+// 페이지 폴트를 처리할 수 없는데, 그때 panic 하지 않고 trap.c 가 onfault 로 돌아오게 해서 -1 이다.
+// 폴트를 처리하며 잠들 수 있으므로 lock 을 잡지 않은 채로 부른다.
+int
+copyuser(void *dst, const void *src, uint n)
+{
+  struct proc *p = myproc();
+  int r;
+
+  asm volatile(
+    "movl $1f, %1\n\t"
+    "rep movsb\n\t"
+    "xorl %0, %0\n\t"
+    "jmp 2f\n"
+    "1:\tmovl $-1, %0\n"
+    "2:\tmovl $0, %1"
+    : "=&r" (r), "=m" (p->onfault), "+D" (dst), "+S" (src), "+c" (n)
+    :
+    : "memory", "cc");
+  return r;
+}
+
+//PAGEBREAK!
+// Blank page.
+//PAGEBREAK!
+// Blank page.
+//PAGEBREAK!
+// Blank page.